@@ -60,6 +60,9 @@ static bool device_services_complete[CONFIG_BT_MAX_CONN];
 static uint8_t devices_pending_completion = 0;
 static bool parallel_discovery_active = false;
 
+/* Devices whose services are being restored after a reconnection in SM_IDLE */
+static bool device_relinking[CONFIG_BT_MAX_CONN];
+
 void app_controller_thread(void)
 {
 	struct app_event evt;
@@ -90,6 +93,12 @@ void app_controller_thread(void)
 			// Wait for an event to trigger action
 			int ret = k_msgq_get(&app_event_queue, &evt, APP_CONTROLLER_ACTION_TIMEOUT);
 			if (ret == -EAGAIN) {
+				if (ble_manager_is_reconnecting() || device_relinking[0] ||
+				    device_relinking[1]) {
+					LOG_DBG("SM_IDLE: Reconnection in progress, staying awake");
+					continue;
+				}
+
 				// Timeout, loop back to wait for event for now
 				LOG_DBG("SM_IDLE: No event received, entering deep sleep");
 				state = SM_POWER_OFF;
@@ -156,8 +165,12 @@ void app_controller_thread(void)
 					break;
 				}
 
-				ble_cmd_has_next_preset(0, false); // HI uses synced presets, so
-								   // only send to one device
+				/* With preset sync one write switches both ears, otherwise
+				 * each ear gets its own command */
+				ble_cmd_has_next_preset(0, false);
+				if (bonded_devices_count == 2 && !has_preset_sync_supported(0)) {
+					ble_cmd_has_next_preset(1, false);
+				}
 				break;
 
 			case EVENT_PAIR_BUTTON_PRESSED:
@@ -209,6 +222,50 @@ void app_controller_thread(void)
 
 				break;
 
+				/**
+				 * A HI that lost its link was reconnected by the ble_manager.
+				 * Restore its services in the same order as SM_BONDED_DEVICES,
+				 * the cached handles make this a short chain of reads.
+				 */
+			case EVENT_DEVICE_READY:
+				LOG_INF("SM_IDLE: [DEVICE ID %d] reconnected, restoring services",
+					evt.device_id);
+				device_relinking[evt.device_id] = true;
+				battery_reader_reset(evt.device_id);
+				ble_cmd_gatt_validate(evt.device_id, false);
+				ble_cmd_dis_read(evt.device_id, false);
+				ble_cmd_bas_discover(evt.device_id, false);
+				break;
+
+			case EVENT_BAS_DISCOVERED:
+				if (!device_relinking[evt.device_id]) {
+					break;
+				}
+				if (evt.error_code == 0) {
+					ble_cmd_bas_read_level(evt.device_id, false);
+				}
+				vcp_controller_reset(evt.device_id);
+				ble_cmd_vcp_discover(evt.device_id, false);
+				break;
+
+			case EVENT_VCP_STATE_READ:
+				/* Also sent on every volume change, only chain while relinking */
+				if (!device_relinking[evt.device_id]) {
+					break;
+				}
+				has_controller_reset(evt.device_id);
+				ble_cmd_has_discover(evt.device_id, false);
+				break;
+
+			case EVENT_HAS_DISCOVERED:
+				if (!device_relinking[evt.device_id]) {
+					break;
+				}
+				device_relinking[evt.device_id] = false;
+				LOG_INF("SM_IDLE: [DEVICE ID %d] services restored (err %d)",
+					evt.device_id, evt.error_code);
+				break;
+
 			case EVENT_HAS_READ_PRESETS:
 				LOG_DBG("SM_IDLE: Reading HAS presets");
 				ble_cmd_has_read_presets(0, false);
@@ -223,6 +280,8 @@ void app_controller_thread(void)
 
 		case SM_POWER_OFF:
 			LOG_DBG("SM_POWER_OFF: Powering off device");
+			device_relinking[0] = false;
+			device_relinking[1] = false;
 			power_manager_prepare_power_off();
 			while (k_msgq_get(&app_event_queue, &evt, K_FOREVER))
 				; // Wait for device disconnect
@@ -276,8 +335,8 @@ void app_controller_thread(void)
 						LOG_INF("Only one device found, selecting it "
 							"automatically");
 					} else {
-						LOG_WRN("Multiple devices found, selecting the "
-							"first one for now");
+						LOG_INF("Multiple devices found, selecting the "
+							"strongest one");
 					}
 				} else {
 					LOG_ERR("Unexpected event %d in SM_FIRST_TIME_USE "
@@ -301,13 +360,14 @@ void app_controller_thread(void)
 					LOG_INF("Only one device found, selecting it "
 						"automatically");
 				} else {
-					LOG_WRN("Multiple devices found, selecting the first one "
-						"for now");
+					LOG_INF("Multiple devices found, selecting the strongest "
+						"one");
 				}
 			}
 
+			/* Connect Device 0 to the scanned device with the strongest smoothed RSSI */
 			ble_manager_connect_to_scanned_device(
-				0, 0); // Connects to first scanned device using Device 0
+				0, devices_manager_get_best_scanned_device_idx());
 
 			/* Now wait for the device to be ready */
 			if (k_msgq_get(&app_event_queue, &evt, APP_CONTROLLER_PAIRING_TIMEOUT) ==
@@ -329,6 +389,9 @@ void app_controller_thread(void)
 				break;
 			}
 
+			/* Identify the firmware before any handles get shared with this device */
+			ble_cmd_gatt_validate(evt.device_id, false);
+			ble_cmd_dis_read(evt.device_id, false);
 			ble_cmd_csip_discover(evt.device_id, false);
 			while (k_msgq_get(&app_event_queue, &evt, K_FOREVER))
 				;
@@ -337,11 +400,15 @@ void app_controller_thread(void)
 				state = SM_IDLE;
 				break;
 			} else {
-				LOG_INF("CSIP discovered for device %d, proceeding to RSI scan",
+				LOG_INF("CSIP discovered for device %d, matching set member",
 					evt.device_id);
 			}
 
-			csip_coordinator_rsi_scan_start(evt.device_id);
+			/* Try the RSIs from the first scan before scanning again */
+			if (csip_coordinator_match_scanned_devices(evt.device_id) != 0) {
+				LOG_INF("Proceeding to RSI scan");
+				csip_coordinator_rsi_scan_start(evt.device_id);
+			}
 			while (k_msgq_get(&app_event_queue, &evt, K_FOREVER))
 				;
 			if (evt.type != EVENT_CSIP_MEMBER_MATCH) {
@@ -382,6 +449,9 @@ void app_controller_thread(void)
 					"SM_FIRST_TIME_USE");
 			}
 
+			/* Identify the firmware before any handles get shared with this device */
+			ble_cmd_gatt_validate(evt.device_id, false);
+			ble_cmd_dis_read(evt.device_id, false);
 			ble_cmd_csip_discover(evt.device_id, false);
 			while (k_msgq_get(&app_event_queue, &evt, K_FOREVER))
 				;
@@ -418,85 +488,42 @@ void app_controller_thread(void)
 			 * SM_FIRST_TIME_USE */
 			devices_manager_update_bonded_devices_collection();
 
-			ble_manager_establish_trusted_bond(0);
-
-			/** If we're bonded to both HIs, establish trusted bond with second HI */
-			if (bonded_devices_count == 2) {
-				/** Wait for first HI to be connected, before we can use
-				 * bt_conn_le_create() again */
-				if (k_msgq_get(&app_event_queue, &evt,
-					       APP_CONTROLLER_PAIRING_TIMEOUT) == 0) {
-					if (evt.type != EVENT_DEVICE_CONNECTED) {
-						LOG_ERR("Unexpected event %d in SM_BONDED_DEVICES",
-							evt.type);
-						state = SM_IDLE;
-						break;
-					} else {
-						LOG_INF("[DEVICE ID %d] connected", evt.device_id);
-					}
-				} else {
-					LOG_ERR("Timeout waiting for device to be connected in "
-						"SM_BONDED_DEVICES");
-					state = SM_POWER_OFF;
-					break;
-				}
+			/** Both HIs are on the controller's accept list, so both connections can be
+			 * started up front and complete in whatever order the HIs are found */
+			for (uint8_t i = 0; i < bonded_devices_count; i++) {
+				ble_manager_establish_trusted_bond(i);
+			}
 
-				ble_manager_establish_trusted_bond(1);
-				/** Wait for second HI to be connected, before we can use
-				 * bt_conn_le_create() again */
+			/** Wait for every HI to be connected and ready, in any order */
+			uint8_t connected_count = 0;
+			uint8_t ready_count = 0;
+			while (connected_count < bonded_devices_count ||
+			       ready_count < bonded_devices_count) {
 				if (k_msgq_get(&app_event_queue, &evt,
-					       APP_CONTROLLER_PAIRING_TIMEOUT) == 0) {
-					if (evt.type != EVENT_DEVICE_CONNECTED) {
-						LOG_ERR("Unexpected event %d in SM_BONDED_DEVICES",
-							evt.type);
-						state = SM_IDLE;
-						break;
-					} else {
-						LOG_INF("[DEVICE ID %d] connected", evt.device_id);
-					}
-				} else {
-					LOG_ERR("Timeout waiting for device to be connected in "
-						"SM_BONDED_DEVICES");
+					       APP_CONTROLLER_PAIRING_TIMEOUT) != 0) {
+					LOG_ERR("Timeout waiting for devices in SM_BONDED_DEVICES "
+						"(%d connected, %d ready)",
+						connected_count, ready_count);
 					state = SM_POWER_OFF;
 					break;
 				}
 
-				/** Waiting for either device to be ready */
-				if (k_msgq_get(&app_event_queue, &evt,
-					       APP_CONTROLLER_PAIRING_TIMEOUT) == 0) {
-					if (evt.type != EVENT_DEVICE_READY) {
-						LOG_ERR("Unexpected event %d in SM_BONDED_DEVICES",
-							evt.type);
-						state = SM_IDLE;
-						break;
-					} else {
-						LOG_INF("[DEVICE ID %d] ready after trusted bond",
-							evt.device_id);
-					}
+				if (evt.type == EVENT_DEVICE_CONNECTED) {
+					LOG_INF("[DEVICE ID %d] connected", evt.device_id);
+					connected_count++;
+				} else if (evt.type == EVENT_DEVICE_READY) {
+					LOG_INF("[DEVICE ID %d] ready after trusted bond",
+						evt.device_id);
+					ready_count++;
 				} else {
-					LOG_ERR("Timeout waiting for device to be ready in "
-						"SM_BONDED_DEVICES");
-					state = SM_POWER_OFF;
-					break;
-				}
-			}
-
-			/** Waiting for either device to be ready */
-			if (k_msgq_get(&app_event_queue, &evt, APP_CONTROLLER_PAIRING_TIMEOUT) ==
-			    0) {
-				if (evt.type != EVENT_DEVICE_READY) {
 					LOG_ERR("Unexpected event %d in SM_BONDED_DEVICES",
 						evt.type);
 					state = SM_IDLE;
 					break;
-				} else {
-					LOG_INF("[DEVICE ID %d] ready after trusted bond",
-						evt.device_id);
 				}
-			} else {
-				LOG_ERR("Timeout waiting for device to be ready in "
-					"SM_BONDED_DEVICES");
-				state = SM_POWER_OFF;
+			}
+
+			if (state != SM_BONDED_DEVICES) {
 				break;
 			}
 
@@ -507,9 +534,15 @@ void app_controller_thread(void)
 				device_services_complete[i] = false;
 			}
 
-			/* Start BAS discovery for ALL devices in parallel */
+			/*
+			 * Start BAS discovery for ALL devices in parallel, after checking
+			 * that the cached handles still match the peer's GATT database and
+			 * reading the firmware the handles are shared on
+			 */
 			for (uint8_t i = 0; i < bonded_devices_count; i++) {
 				battery_reader_reset(i);
+				ble_cmd_gatt_validate(i, false);
+				ble_cmd_dis_read(i, false);
 				ble_cmd_bas_discover(i, false);
 			}
 
@@ -1,6 +1,6 @@
 /**
  * @file bas_settings.h
- * @brief BAS handle caching in NVS settings
+ * @brief BAS handle caching in the GATT cache record
  */
 
 #ifndef BAS_SETTINGS_H_
@@ -16,6 +16,7 @@ struct bt_bas_handles {
 	uint16_t service_handle;
 	uint16_t service_handle_end;
 	uint16_t battery_level_handle;
+	uint16_t battery_level_ccc_handle; /* 0 if Battery Level does not notify */
 };
 
 /**
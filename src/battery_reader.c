@@ -1,8 +1,10 @@
 #include "battery_reader.h"
 #include "bas_settings.h"
+#include "gatt_cache.h"
 #include "devices_manager.h"
 #include "app_controller.h"
 #include "display_manager.h"
+#include "retained_state.h"
 
 LOG_MODULE_REGISTER(battery_reader, LOG_LEVEL_INF);
 
@@ -13,6 +15,32 @@ uint8_t battery_level = 0;
 /* Track whether handles were loaded from cache (per device) - skip re-storing if true */
 static bool handles_from_cache[CONFIG_BT_MAX_CONN];
 
+/* Battery Level notification state (per device) */
+static bool level_notify_supported[CONFIG_BT_MAX_CONN];
+static struct bt_gatt_discover_params ccc_discover_params[CONFIG_BT_MAX_CONN];
+static struct bt_gatt_subscribe_params battery_sub_params[CONFIG_BT_MAX_CONN];
+/* k_uptime_get() of the current subscription, 0 if not subscribed on this link */
+static int64_t subscribed_at[CONFIG_BT_MAX_CONN];
+/* Identity address each subscription was registered for, it outlives the link */
+static bt_addr_le_t subscribed_peer[CONFIG_BT_MAX_CONN];
+
+/**
+ * Bonded HIs that hold our Battery Level CCC, kept through System OFF. A bonded server keeps
+ * the CCC across connections, so after a wake the subscription is only registered locally.
+ */
+struct battery_ccc_peers {
+	bt_addr_le_t addr[CONFIG_BT_MAX_PAIRED];
+	uint8_t next;
+};
+
+static __noinit struct battery_ccc_peers ccc_peers;
+static __noinit struct retained_seal ccc_peers_seal;
+static bool ccc_peers_restored;
+static struct k_spinlock ccc_peers_lock;
+
+/* Command the level read completes, it may run in either command lane */
+static struct ble_cmd *level_read_cmd[CONFIG_BT_MAX_CONN];
+
 /* Read callback for battery level characteristic */
 static uint8_t battery_read_cb(struct bt_conn *conn, uint8_t err,
 							   struct bt_gatt_read_params *params,
@@ -23,40 +51,269 @@ static uint8_t battery_read_cb(struct bt_conn *conn, uint8_t err,
 	if (err)
 	{
 		LOG_ERR("Battery level read failed (err %u) [DEVICE ID %d]", err, ctx->device_id);
-		ble_cmd_complete(ctx->device_id, err);
+		ble_cmd_complete_cmd(ctx->device_id, level_read_cmd[ctx->device_id], err);
 		return 0;
 	}
 
 	if (!data)
 	{
 		LOG_DBG("Battery level read complete [DEVICE ID %d]", ctx->device_id);
-		ble_cmd_complete(ctx->device_id, -1);
+		ble_cmd_complete_cmd(ctx->device_id, level_read_cmd[ctx->device_id], -1);
 		return 0;
 	}
 
 	if (length != 1)
 	{
 		LOG_WRN("Unexpected battery level length: %u [DEVICE ID %d]", length, ctx->device_id);
-		ble_cmd_complete(ctx->device_id, -2);
+		ble_cmd_complete_cmd(ctx->device_id, level_read_cmd[ctx->device_id], -2);
 		return 0;
 	}
 
-	ctx->bas_ctlr.battery_level = *(uint8_t *)data;
+	ble_manager_set_device_ctx_battery_level(conn, *(uint8_t *)data);
 	LOG_INF("Battery level read: %u%% [DEVICE ID %d]", ctx->bas_ctlr.battery_level, ctx->device_id);
 
 	/* Update display with battery level */
 	display_manager_update_battery(ctx->device_id, ctx->bas_ctlr.battery_level);
 
-	ble_cmd_complete(ctx->device_id, 0);
+	ble_cmd_complete_cmd(ctx->device_id, level_read_cmd[ctx->device_id], 0);
 
 	return 0;
 }
 
-/* Read parameters for battery level */
-static struct bt_gatt_read_params battery_read_params = {
-	.func = battery_read_cb,
-	.handle_count = 1,
-};
+/* Read parameters for battery level, per device since both links can read at once */
+static struct bt_gatt_read_params battery_read_params[CONFIG_BT_MAX_CONN];
+
+/* Notification callback for battery level */
+static uint8_t battery_notify_cb(struct bt_conn *conn, struct bt_gatt_subscribe_params *params,
+								 const void *data, uint16_t length)
+{
+	struct device_context *ctx = devices_manager_get_device_context_by_conn(conn);
+
+	if (!data)
+	{
+		LOG_DBG("Battery level unsubscribed");
+		params->value_handle = 0;
+		subscribed_at[params - battery_sub_params] = 0;
+		return BT_GATT_ITER_STOP;
+	}
+
+	if (!ctx || length != 1)
+	{
+		return BT_GATT_ITER_CONTINUE;
+	}
+
+	ble_manager_set_device_ctx_battery_level(conn, *(uint8_t *)data);
+	LOG_INF("Battery level notified: %u%% [DEVICE ID %d]", ctx->bas_ctlr.battery_level, ctx->device_id);
+
+	display_manager_update_battery(ctx->device_id, ctx->bas_ctlr.battery_level);
+
+	return BT_GATT_ITER_CONTINUE;
+}
+
+/* True if the bonded peer was seen to accept our CCC write before the last System OFF */
+static bool battery_ccc_peer_known(const bt_addr_le_t *addr)
+{
+	bool known = false;
+	k_spinlock_key_t key = k_spin_lock(&ccc_peers_lock);
+
+	for (uint8_t i = 0; i < ARRAY_SIZE(ccc_peers.addr); i++)
+	{
+		if (bt_addr_le_eq(&ccc_peers.addr[i], addr))
+		{
+			known = true;
+			break;
+		}
+	}
+
+	k_spin_unlock(&ccc_peers_lock, key);
+	return known;
+}
+
+/* Subscribe callback, the CCC write was acknowledged */
+static void battery_subscribe_cb(struct bt_conn *conn, uint8_t err,
+								 struct bt_gatt_subscribe_params *params)
+{
+	const bt_addr_le_t *addr = bt_conn_get_dst(conn);
+
+	if (err || !params->value || battery_ccc_peer_known(addr))
+	{
+		return;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&ccc_peers_lock);
+	bt_addr_le_copy(&ccc_peers.addr[ccc_peers.next], addr);
+	ccc_peers.next = (ccc_peers.next + 1) % ARRAY_SIZE(ccc_peers.addr);
+	k_spin_unlock(&ccc_peers_lock, key);
+}
+
+/* Subscribe to battery level notifications */
+int battery_subscribe_notifications(uint8_t device_id)
+{
+	struct device_context *ctx = devices_manager_get_device_context_by_id(device_id);
+	struct bt_gatt_subscribe_params *params = &battery_sub_params[device_id];
+
+	if (!ctx->conn)
+	{
+		return -ENOTCONN;
+	}
+
+	if (ctx->bas_ctlr.battery_level_ccc_handle == 0)
+	{
+		return -ENOTSUP;
+	}
+
+	const bt_addr_le_t *addr = bt_conn_get_dst(ctx->conn);
+
+	if (!ccc_peers_restored)
+	{
+		retained_state_restore("Battery CCC peers", &ccc_peers_seal, &ccc_peers,
+							   sizeof(ccc_peers));
+		ccc_peers_restored = true;
+	}
+
+	if (params->value_handle != 0)
+	{
+		if (bt_addr_le_eq(&subscribed_peer[device_id], addr) &&
+			params->value_handle == ctx->bas_ctlr.battery_level_handle &&
+			params->ccc_handle == ctx->bas_ctlr.battery_level_ccc_handle)
+		{
+			/* Registered on an earlier link, the bonded peer kept the CCC */
+			subscribed_at[device_id] = k_uptime_get();
+			LOG_DBG("Battery level subscription kept from the last link [DEVICE ID %d]",
+					ctx->device_id);
+			return 0;
+		}
+
+		if (!bt_addr_le_eq(&subscribed_peer[device_id], addr))
+		{
+			LOG_WRN("Battery level subscription held by another peer [DEVICE ID %d]",
+					ctx->device_id);
+			return -EBUSY;
+		}
+
+		/* The handles moved, the parameters are in use until the old CCC is cleared */
+		LOG_WRN("Battery level handles changed, subscribing on the next link [DEVICE ID %d]",
+				ctx->device_id);
+		bt_gatt_unsubscribe(ctx->conn, params);
+		return -EAGAIN;
+	}
+
+	memset(params, 0, sizeof(*params));
+	params->notify = battery_notify_cb;
+	params->subscribe = battery_subscribe_cb;
+	params->value = BT_GATT_CCC_NOTIFY;
+	params->value_handle = ctx->bas_ctlr.battery_level_handle;
+	params->ccc_handle = ctx->bas_ctlr.battery_level_ccc_handle;
+	/* Kept across links with the bonded peer, which keeps the CCC, so no write on relink */
+	atomic_set_bit(params->flags, BT_GATT_SUBSCRIBE_FLAG_NO_RESUB);
+
+	int err;
+	bool resubscribed = !ctx->info.is_new_device && battery_ccc_peer_known(addr);
+
+	if (resubscribed)
+	{
+		/* Written before the last System OFF, only registered locally */
+		err = bt_gatt_resubscribe(BT_ID_DEFAULT, addr, params);
+	}
+	else
+	{
+		err = bt_gatt_subscribe(ctx->conn, params);
+	}
+
+	if (err && err != -EALREADY)
+	{
+		LOG_ERR("Battery level subscription failed (err %d) [DEVICE ID %d]", err, ctx->device_id);
+		params->value_handle = 0;
+		return err;
+	}
+
+	bt_addr_le_copy(&subscribed_peer[device_id], addr);
+	subscribed_at[device_id] = k_uptime_get();
+
+	LOG_DBG("%s battery level (handle 0x%04X, CCC 0x%04X) [DEVICE ID %d]",
+			resubscribed ? "Resubscribed to" : "Subscribed to", params->value_handle,
+			params->ccc_handle, ctx->device_id);
+	return 0;
+}
+
+bool battery_reader_level_is_fresh(uint8_t device_id)
+{
+	struct device_context *ctx = devices_manager_get_device_context_by_id(device_id);
+
+	/**
+	 * Notifications keep the level current for as long as the subscription lasts, but only
+	 * a level received since subscribing on this link. An older one is bounded by age.
+	 */
+	if (ctx->conn && battery_sub_params[device_id].value_handle != 0 &&
+		subscribed_at[device_id] != 0 &&
+		ctx->bas_ctlr.battery_level_updated >= subscribed_at[device_id])
+	{
+		return true;
+	}
+
+	return ctx->bas_ctlr.battery_level_updated != 0 &&
+		   k_uptime_get() - ctx->bas_ctlr.battery_level_updated < BAS_LEVEL_FRESH_MS;
+}
+
+/* Battery Service handles are known, cache them, subscribe and complete the discovery */
+static void battery_discovery_finish(struct device_context *ctx)
+{
+	ctx->info.bas_discovered = true;
+
+	/* Only extract and cache handles if they weren't loaded from cache.
+	 * This avoids unnecessary stack usage from settings operations when
+	 * handles are already in NVS. */
+	if (!handles_from_cache[ctx->device_id]) {
+		/* Cache handles for future reconnections */
+		struct bt_bas_handles handles = {
+			.service_handle = ctx->bas_ctlr.battery_service_handle,
+			.service_handle_end = ctx->bas_ctlr.battery_service_handle_end,
+			.battery_level_handle = ctx->bas_ctlr.battery_level_handle,
+			.battery_level_ccc_handle = ctx->bas_ctlr.battery_level_ccc_handle,
+		};
+
+		/* Store handles for the current device */
+		bas_settings_store_handles(&ctx->info.addr, &handles);
+
+		/* Reuse the handles for the other set member if it runs the same firmware */
+		gatt_cache_share_with_set(&ctx->info.addr, GATT_CACHE_BAS, &handles,
+					  sizeof(handles));
+	} else {
+		LOG_DBG("Handles were loaded from cache, skipping re-storage");
+	}
+
+	int err = battery_subscribe_notifications(ctx->device_id);
+	if (err && err != -ENOTSUP)
+	{
+		LOG_WRN("Battery level updates will need reads (err %d) [DEVICE ID %d]", err, ctx->device_id);
+	}
+
+	// Complete the discovery command
+	LOG_DBG("Battery Service discovery complete (handle: 0x%04x, CCC: 0x%04x) [DEVICE ID %d]",
+	        ctx->bas_ctlr.battery_level_handle, ctx->bas_ctlr.battery_level_ccc_handle, ctx->device_id);
+
+	app_controller_notify_bas_discovered(ctx->device_id, 0);
+	ble_cmd_complete(ctx->device_id, 0);
+}
+
+/* Discovery callback for the Battery Level CCC descriptor */
+static uint8_t discover_ccc_cb(struct bt_conn *conn,
+							   const struct bt_gatt_attr *attr,
+							   struct bt_gatt_discover_params *params)
+{
+	struct device_context *ctx = devices_manager_get_device_context_by_conn(conn);
+
+	if (attr)
+	{
+		LOG_DBG("Found Battery Level CCC at handle 0x%04X [DEVICE ID %d]", attr->handle, ctx->device_id);
+		ctx->bas_ctlr.battery_level_ccc_handle = attr->handle;
+	} else {
+		LOG_WRN("Battery Level notifies but has no CCC [DEVICE ID %d]", ctx->device_id);
+	}
+
+	battery_discovery_finish(ctx);
+	return BT_GATT_ITER_STOP;
+}
 
 /* Discovery callback for Battery Service characteristics */
 static uint8_t discover_char_cb(struct bt_conn *conn,
@@ -70,76 +327,24 @@ static uint8_t discover_char_cb(struct bt_conn *conn,
 		LOG_DBG("Discovery complete for type %d [DEVICE ID %d]", params->type, ctx->device_id);
 
 		/* If we have the characteristic handle, mark discovery as complete */
-		if (ctx->bas_ctlr.battery_level_handle != 0) {
-			ctx->info.bas_discovered = true;
-
-			/* Only extract and cache handles if they weren't loaded from cache.
-			 * This avoids unnecessary stack usage from settings operations when
-			 * handles are already in NVS. */
-			if (!handles_from_cache[ctx->device_id]) {
-				/* Cache handles for future reconnections */
-				struct bt_bas_handles handles = {
-					.service_handle = ctx->bas_ctlr.battery_service_handle,
-					.service_handle_end = ctx->bas_ctlr.battery_service_handle_end,
-					.battery_level_handle = ctx->bas_ctlr.battery_level_handle,
-				};
-
-				/* Store handles for the current device */
-				bas_settings_store_handles(&ctx->info.addr, &handles);
-
-				/* If this is a new device (initial pairing) and part of a CSIP set, also store handles
-				 * for all other set members. Since all hearing aids in the set have identical firmware
-				 * and GATT layout, we can reuse the same handles for all set members.
-				 * Skip this on reconnection to avoid unnecessary work and potential stack issues. */
-				// if (ctx->info.is_new_device) {
-					struct bond_collection collection;
-					if (devices_manager_get_bonded_devices_collection(&collection) == 0) {
-						struct bonded_device_entry current_entry;
-						if (devices_manager_find_bonded_entry_by_addr(&ctx->info.addr, &current_entry) && current_entry.is_set_member) {
-						LOG_DBG("Current device is CSIP set member, caching BAS handles for all set members");
-						LOG_DBG("Bonded devices count: %d", collection.count);
-						LOG_HEXDUMP_DBG(current_entry.sirk, CSIP_SIRK_SIZE, "Current device SIRK:");
-
-						for (uint8_t i = 0; i < collection.count; i++) {
-							char debug_addr[BT_ADDR_LE_STR_LEN];
-							bt_addr_le_to_str(&collection.devices[i].addr, debug_addr, sizeof(debug_addr));
-							LOG_DBG("  Device %d: %s, is_set_member=%d, set_rank=%d",
-								i, debug_addr, collection.devices[i].is_set_member, collection.devices[i].set_rank);
-							if (collection.devices[i].is_set_member) {
-								LOG_HEXDUMP_DBG(collection.devices[i].sirk, CSIP_SIRK_SIZE, "  Device SIRK:");
-							}
-							/* Skip the current device (already stored) */
-							if (bt_addr_le_cmp(&collection.devices[i].addr, &ctx->info.addr) == 0) {
-								continue;
-							}
-
-							/* Only store for devices in the same CSIP set */
-							if (collection.devices[i].is_set_member &&
-								memcmp(collection.devices[i].sirk, current_entry.sirk, CSIP_SIRK_SIZE) == 0) {
-
-								int err = bas_settings_store_handles(&collection.devices[i].addr, &handles);
-								if (err == 0) {
-									char addr_str[BT_ADDR_LE_STR_LEN];
-									bt_addr_le_to_str(&collection.devices[i].addr, addr_str, sizeof(addr_str));
-									LOG_INF("BAS handles also cached for set member: %s", addr_str);
-								} else {
-									LOG_WRN("Failed to cache BAS handles for set member (err %d)", err);
-								}
-							}
-						}
-					}
-					}
-				// }
-			} else {
-				LOG_DBG("Handles were loaded from cache, skipping re-storage");
+		if (ctx->bas_ctlr.battery_level_handle != 0 && level_notify_supported[ctx->device_id]) {
+			/* The CCC follows the value handle within the service */
+			struct bt_gatt_discover_params *ccc_params = &ccc_discover_params[ctx->device_id];
+
+			memset(ccc_params, 0, sizeof(*ccc_params));
+			ccc_params->uuid = BT_UUID_GATT_CCC;
+			ccc_params->type = BT_GATT_DISCOVER_DESCRIPTOR;
+			ccc_params->start_handle = ctx->bas_ctlr.battery_level_handle + 1;
+			ccc_params->end_handle = ctx->bas_ctlr.battery_service_handle_end;
+			ccc_params->func = discover_ccc_cb;
+
+			int err = bt_gatt_discover(conn, ccc_params);
+			if (err) {
+				LOG_WRN("Failed to discover Battery Level CCC (err %d) [DEVICE ID %d]", err, ctx->device_id);
+				battery_discovery_finish(ctx);
 			}
-
-			// Complete the discovery command
-			LOG_DBG("Battery Service discovery complete (handle: 0x%04x, CCC: 0x%04x) [DEVICE ID %d]",
-			        ctx->bas_ctlr.battery_level_handle, ctx->bas_ctlr.battery_level_ccc_handle, ctx->device_id);
-
-			app_controller_notify_bas_discovered(ctx->device_id, 0);
-			ble_cmd_complete(ctx->device_id, 0);
+		} else if (ctx->bas_ctlr.battery_level_handle != 0) {
+			battery_discovery_finish(ctx);
 		} else {
 			LOG_ERR("Battery Service discovery completed but no characteristic found [DEVICE ID %d]", ctx->device_id);
 			app_controller_notify_bas_discovered(ctx->device_id, -EINVAL);
@@ -157,6 +362,7 @@ static uint8_t discover_char_cb(struct bt_conn *conn,
 		if (!bt_uuid_cmp(chrc->uuid, BT_UUID_BAS_BATTERY_LEVEL)) {
 			LOG_DBG("Found Battery Level characteristic at handle 0x%04X (properties 0x%02X) [DEVICE ID %d]", chrc->value_handle, chrc->properties, ctx->device_id);
 			ctx->bas_ctlr.battery_level_handle = chrc->value_handle;
+			level_notify_supported[ctx->device_id] = (chrc->properties & BT_GATT_CHRC_NOTIFY) != 0;
 
 			// return BT_GATT_ITER_STOP;
 		}
@@ -234,11 +440,10 @@ int battery_discover(uint8_t device_id)
 			ctx->bas_ctlr.battery_service_handle = cached_handles.service_handle;
 			ctx->bas_ctlr.battery_service_handle_end = cached_handles.service_handle_end;
 			ctx->bas_ctlr.battery_level_handle = cached_handles.battery_level_handle;
-			ctx->info.bas_discovered = true;
+			ctx->bas_ctlr.battery_level_ccc_handle = cached_handles.battery_level_ccc_handle;
 			handles_from_cache[device_id] = true;
 
-			app_controller_notify_bas_discovered(ctx->device_id, 0);
-			ble_cmd_complete(ctx->device_id, 0);
+			battery_discovery_finish(ctx);
 			return 0;
 		}
 
@@ -265,10 +470,12 @@ int battery_discover(uint8_t device_id)
 }
 
 /* Read battery level */
-int battery_read_level(uint8_t device_id)
+int battery_read_level(uint8_t device_id, struct ble_cmd *cmd)
 {
 	struct device_context *ctx = devices_manager_get_device_context_by_id(device_id);
 	
+	level_read_cmd[device_id] = cmd;
+
 	if (!ctx->conn)
 	{
 		LOG_ERR("Invalid connection [DEVICE ID %d]", ctx->device_id);
@@ -281,12 +488,30 @@ int battery_read_level(uint8_t device_id)
 		return -ENOENT;
 	}
 
-	LOG_DBG("Reading battery level from handle 0x%04X [DEVICE ID %d]", ctx->bas_ctlr.battery_level_handle, ctx->device_id);
+	if (battery_reader_level_is_fresh(device_id))
+	{
+		/* Kept current by notifications or read recently, no need for another ATT exchange */
+		LOG_INF("Battery level %u%% is fresh, skipping read [DEVICE ID %d]",
+				ctx->bas_ctlr.battery_level, ctx->device_id);
+		display_manager_update_battery(ctx->device_id, ctx->bas_ctlr.battery_level);
+		ble_cmd_complete_cmd(device_id, level_read_cmd[device_id], 0);
+		return 0;
+	}
 
-	battery_read_params.single.handle = ctx->bas_ctlr.battery_level_handle;
-	battery_read_params.single.offset = 0;
+	LOG_DBG("Reading battery level from handle 0x%04X [DEVICE ID %d]", ctx->bas_ctlr.battery_level_handle, ctx->device_id);
 
-	int err = bt_gatt_read(ctx->conn, &battery_read_params);
+	struct bt_gatt_read_params *params = &battery_read_params[device_id];
+	params->func = battery_read_cb;
+	params->handle_count = 1;
+	params->single.handle = ctx->bas_ctlr.battery_level_handle;
+	params->single.offset = 0;
+#if defined(CONFIG_BT_EATT)
+	/* Keep the unenhanced bearer free for interactive commands */
+	params->chan_opt = ble_cmd_use_background_bearer(device_id) ? BT_ATT_CHAN_OPT_ENHANCED_ONLY
+																: BT_ATT_CHAN_OPT_NONE;
+#endif
+
+	int err = bt_gatt_read(ctx->conn, params);
 	if (err)
 	{
 		LOG_ERR("Battery level read failed (err %d) [DEVICE ID %d]", err, ctx->device_id);
@@ -304,8 +529,10 @@ void battery_reader_reset(uint8_t device_id)
 	ctx->info.bas_discovered = false;
 	ctx->bas_ctlr.battery_level_handle = 0;
 	ctx->bas_ctlr.battery_level_ccc_handle = 0;
-	ctx->bas_ctlr.battery_level = 0;
+	/* The level and its timestamp are kept, a relink can reuse a fresh level */
 	handles_from_cache[device_id] = false;
+	level_notify_supported[device_id] = false;
+	subscribed_at[device_id] = 0;
 	LOG_DBG("Battery reader state reset [DEVICE ID %d]", ctx->device_id);
 }
 
@@ -27,17 +27,41 @@ int battery_discover(uint8_t device_id);
  * @brief Read battery level from discovered battery service
  * 
  * @param conn Pointer to the BLE connection
+ * @param cmd Command to complete once the level is known
  * @return 0 on success, negative error code on failure
  */
-int battery_read_level(uint8_t device_id);
+int battery_read_level(uint8_t device_id, struct ble_cmd *cmd);
+
+/**
+ * @brief A battery level younger than this is used without reading it again. Levels
+ * received since subscribing on the current link stay current, so this only bounds how
+ * long a level is trusted across a relink.
+ *
+ * Uptime does not run through System OFF, so the first read after a wake is never skipped.
+ * Only relinks within a wake save the read.
+ */
+#define BAS_LEVEL_FRESH_MS (10 * 60 * 1000)
 
 /**
  * @brief Subscribe to battery level notifications
- * 
- * @param conn Pointer to the BLE connection
- * @return 0 on success, negative error code on failure
+ *
+ * The subscription is kept across links, the bonded peer keeps the CCC. The CCC is only
+ * written for a peer that was not seen to accept it before, so relinks and wakes from
+ * System OFF register the subscription without an ATT exchange.
+ *
+ * @param device_id Device ID
+ * @return 0 on success, -ENOTSUP if Battery Level does not notify, negative error code on failure
+ */
+int battery_subscribe_notifications(uint8_t device_id);
+
+/**
+ * @brief Check whether the battery level of a device is known and recent
+ *
+ * @param device_id Device ID
+ * @return true if the level was received since subscribing on the current link, or was
+ *         read or notified within BAS_LEVEL_FRESH_MS
  */
-int battery_subscribe_notifications();
+bool battery_reader_level_is_fresh(uint8_t device_id);
 
 /**
  * @brief Reset battery reader state
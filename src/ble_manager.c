@@ -7,6 +7,11 @@
 #include "has_controller.h"
 #include "display_manager.h"
 #include "power_manager.h"
+#include "link_manager.h"
+#include "gatt_cache.h"
+
+/* Host internals, the public API cannot tell whether the P-256 key pair is ready */
+#include "host/ecc.h"
 
 LOG_MODULE_REGISTER(ble_manager, LOG_LEVEL_DBG);
 
@@ -22,8 +27,69 @@ K_SEM_DEFINE(ble_cmd_sem_1, 0, 1);
 static struct k_sem *ble_cmd_sem[2] = {&ble_cmd_sem_0, &ble_cmd_sem_1};
 static struct k_work_delayable ble_cmd_timeout_work[2];
 static bool ble_cmd_in_progress[2] = {false, false};
+
+BUILD_ASSERT(CONFIG_BT_L2CAP_TX_MTU >= APP_ATT_MTU_MIN,
+			 "CONFIG_BT_L2CAP_TX_MTU too small for a full HAS preset record");
+BUILD_ASSERT(CONFIG_BT_BUF_ACL_RX_SIZE >= APP_ATT_MTU_MIN + BT_L2CAP_HDR_SIZE +
+				 (IS_ENABLED(CONFIG_BT_EATT) ? BT_L2CAP_SDU_HDR_SIZE : 0),
+			 "CONFIG_BT_BUF_ACL_RX_SIZE too small for a full HAS preset record");
+
+/* Commands that need the full MTU wait for the exchange, see APP_ATT_MTU_MIN */
+static bool mtu_ready[2];
+static struct k_work_delayable mtu_wait_work[2];
+
+/* Background command lane, only used on links with EATT bearers */
+static sys_slist_t ble_bg_cmd_queue[2];
+static struct ble_cmd *ble_bg_cmd[2];
+static struct k_work ble_bg_cmd_work[2];
+static struct k_work_delayable ble_bg_cmd_timeout_work[2];
+/* Guards ble_bg_cmd, completions arrive from the BT RX thread and the workqueue */
+static struct k_spinlock ble_bg_lock;
 static bool security_request_in_progress = false;
 
+/* HI scan state */
+static atomic_t hi_scan_active;
+static struct k_work_delayable scan_settle_work;
+static struct k_work_delayable scan_phase_work;
+
+/* Accept list connection state */
+static uint8_t accept_list_count;
+static bool auto_connect_pending = false;
+
+/* Advertising reports and connection initiations seen by the host, to show host wakeups
+ * while reconnecting */
+static atomic_t host_adv_reports;
+static atomic_t conn_initiations;
+static struct {
+	int64_t start_time;
+	atomic_val_t adv_reports;
+	atomic_val_t initiations;
+} reconnect_stats[2];
+
+static void scan_recv_listener(const struct bt_le_scan_recv_info *info, struct net_buf_simple *buf)
+{
+	atomic_inc(&host_adv_reports);
+}
+
+/* Sees the reports of every scan, whoever started it */
+static struct bt_le_scan_cb scan_listener = {
+	.recv = scan_recv_listener,
+};
+
+/* Link loss reconnection state */
+static struct {
+	bool active;
+	uint8_t attempts;
+	int64_t start_time;
+} reconnect[2];
+
+/* Pairing timing */
+static int64_t pairing_start_time[2];
+static bool pairing_key_ready_at_start[2];
+/* k_uptime_get() when a key pair generation was awaited, reported when it completes */
+static int64_t pairing_key_wait_start;
+static struct bt_pub_key_cb pairing_key_cb;
+
 /* Memory pool for BLE commands */
 K_MEM_SLAB_DEFINE(ble_cmd_slab_0, sizeof(struct ble_cmd), BLE_CMD_QUEUE_SIZE, 4);
 K_MEM_SLAB_DEFINE(ble_cmd_slab_1, sizeof(struct ble_cmd), BLE_CMD_QUEUE_SIZE, 4);
@@ -31,7 +97,12 @@ K_MEM_SLAB_DEFINE(ble_cmd_slab_1, sizeof(struct ble_cmd), BLE_CMD_QUEUE_SIZE, 4)
 /* Forward declarations */
 static void ble_process_next_command(uint8_t queue_id);
 static void ble_cmd_timeout_handler(struct k_work *work);
+static void ble_bg_cmd_work_handler(struct k_work *work);
+static void ble_bg_cmd_timeout_handler(struct k_work *work);
+static void mtu_wait_work_handler(struct k_work *work);
 static void connect_work_handler(struct k_work *work);
+static int ble_manager_auto_connect(void);
+static void ble_manager_schedule_reconnect(uint8_t device_id);
 // static bool is_bonded_device(const bt_addr_le_t *addr);
 static char *command_type_to_string(enum ble_cmd_type type);
 
@@ -44,6 +115,10 @@ static int ble_queues_init(void)
 		k_mutex_init(&ble_queue_mutex[i]);
 		/* Semaphores are now statically initialized with K_SEM_DEFINE */
 		k_work_init_delayable(&ble_cmd_timeout_work[i], ble_cmd_timeout_handler);
+		sys_slist_init(&ble_bg_cmd_queue[i]);
+		k_work_init(&ble_bg_cmd_work[i], ble_bg_cmd_work_handler);
+		k_work_init_delayable(&ble_bg_cmd_timeout_work[i], ble_bg_cmd_timeout_handler);
+		k_work_init_delayable(&mtu_wait_work[i], mtu_wait_work_handler);
 		device_ctx[i].current_ble_cmd = NULL;
 	}
 
@@ -76,6 +151,105 @@ static void ble_cmd_free(struct ble_cmd *cmd)
 	}
 }
 
+/**
+ * @brief Check whether a device's link has EATT bearers for concurrent GATT procedures
+ *
+ * @param device_id Device ID
+ * @return true if background commands can run on their own bearer
+ */
+bool ble_cmd_use_background_bearer(uint8_t device_id)
+{
+#if defined(CONFIG_BT_EATT)
+	return device_ctx[device_id].conn && bt_eatt_count(device_ctx[device_id].conn) > 0;
+#else
+	return false;
+#endif
+}
+
+/* Let commands waiting for the MTU exchange run, in both lanes */
+static void ble_cmd_mtu_ready(uint8_t device_id)
+{
+	mtu_ready[device_id] = true;
+	k_sem_give(ble_cmd_sem[device_id]);
+	k_work_submit(&ble_bg_cmd_work[device_id]);
+}
+
+static void mtu_wait_work_handler(struct k_work *work)
+{
+	uint8_t device_id = (work == &mtu_wait_work[0].work) ? 0 : 1;
+
+	LOG_WRN("No MTU exchange after %d ms, continuing with MTU %d [DEVICE ID %d]",
+			BT_MTU_EXCHANGE_WAIT_MS,
+			device_ctx[device_id].conn ? bt_gatt_get_mtu(device_ctx[device_id].conn) : 0,
+			device_id);
+	ble_cmd_mtu_ready(device_id);
+}
+
+static void att_mtu_updated_cb(struct bt_conn *conn, uint16_t tx, uint16_t rx)
+{
+	struct device_context *ctx = devices_manager_get_device_context_by_conn(conn);
+	if (!ctx)
+	{
+		return;
+	}
+
+	LOG_INF("ATT MTU updated: TX %d, RX %d, needed %d [DEVICE ID %d]", tx, rx,
+			APP_ATT_MTU_MIN, ctx->device_id);
+	k_work_cancel_delayable(&mtu_wait_work[ctx->device_id]);
+	ble_cmd_mtu_ready(ctx->device_id);
+}
+
+static struct bt_gatt_cb gatt_callbacks = {
+	.att_mtu_updated = att_mtu_updated_cb,
+};
+
+/**
+ * @brief Check whether a command may run yet, given the MTU it needs
+ *
+ * Preset reads wait for the MTU exchange so that every preset record fits in one PDU.
+ * Reads that still run with a smaller MTU are counted in the link telemetry.
+ *
+ * @return true if the command can be executed now
+ */
+static bool ble_cmd_mtu_check(const struct ble_cmd *cmd)
+{
+	if (cmd->type != BLE_CMD_HAS_READ_PRESETS || device_ctx[cmd->device_id].has_ctlr.presets_read)
+	{
+		/* A cached preset list is served without any ATT traffic */
+		return true;
+	}
+
+	if (!mtu_ready[cmd->device_id])
+	{
+		LOG_DBG("Waiting for MTU exchange before %s [DEVICE ID %d]",
+				command_type_to_string(cmd->type), cmd->device_id);
+		return false;
+	}
+
+	struct bt_conn *conn = device_ctx[cmd->device_id].conn;
+	if (conn && bt_gatt_get_mtu(conn) < APP_ATT_MTU_MIN)
+	{
+		LOG_WRN("%s with MTU %d, preset records may not fit one PDU [DEVICE ID %d]",
+				command_type_to_string(cmd->type), bt_gatt_get_mtu(conn), cmd->device_id);
+		link_manager_record_short_mtu(cmd->device_id);
+	}
+
+	return true;
+}
+
+static bool ble_cmd_is_background(const struct ble_cmd *cmd)
+{
+	switch (cmd->type)
+	{
+	case BLE_CMD_BAS_READ_LEVEL:
+	case BLE_CMD_HAS_READ_PRESETS:
+		return ble_cmd_use_background_bearer(cmd->device_id);
+
+	default:
+		return false;
+	}
+}
+
 /* Enqueue a command */
 static int ble_cmd_enqueue(struct ble_cmd *cmd, bool high_priority)
 {
@@ -90,6 +264,19 @@ static int ble_cmd_enqueue(struct ble_cmd *cmd, bool high_priority)
 		return -EINVAL;
 	}
 
+	if (ble_cmd_is_background(cmd))
+	{
+		k_mutex_lock(&ble_queue_mutex[cmd->device_id], K_FOREVER);
+		sys_slist_append(&ble_bg_cmd_queue[cmd->device_id], &cmd->node);
+		k_mutex_unlock(&ble_queue_mutex[cmd->device_id]);
+
+		k_work_submit(&ble_bg_cmd_work[cmd->device_id]);
+
+		LOG_DBG("Background BLE command enqueued, type: %s [DEVICE ID %d]",
+				command_type_to_string(cmd->type), cmd->device_id);
+		return 0;
+	}
+
 	k_mutex_lock(&ble_queue_mutex[cmd->device_id], K_FOREVER);
 	if (high_priority)
 	{
@@ -126,6 +313,44 @@ static struct ble_cmd *ble_cmd_dequeue(uint8_t device_id)
 	return cmd;
 }
 
+/* Key pair generation finished, SMP got the key through its own callback */
+static void pairing_key_ready_cb(const uint8_t key[BT_PUB_KEY_LEN])
+{
+	if (!key)
+	{
+		LOG_WRN("Pairing key generation failed");
+		return;
+	}
+
+	LOG_INF("Pairing key ready after %lld ms", k_uptime_get() - pairing_key_wait_start);
+}
+
+/**
+ * @brief Report the local P-256 key pair once the host has generated it
+ *
+ * Only called while no key is available, i.e. while the host is generating one, or to
+ * start a fresh one under BT_PAIRING_KEY_PER_PAIRING. bt_pub_key_gen() regenerates the
+ * key if one is already there.
+ */
+static void ble_manager_watch_pairing_key(void)
+{
+	pairing_key_wait_start = k_uptime_get();
+	pairing_key_cb.func = pairing_key_ready_cb;
+
+	int err = bt_pub_key_gen(&pairing_key_cb);
+	if (err && err != -EALREADY)
+	{
+		LOG_WRN("Failed to watch pairing key generation (err %d)", err);
+	}
+}
+
+/* Records the start of a pairing and whether it has to wait for the key pair */
+static void ble_manager_pairing_started(uint8_t device_id)
+{
+	pairing_start_time[device_id] = k_uptime_get();
+	pairing_key_ready_at_start[device_id] = (bt_pub_key_get() != NULL);
+}
+
 static void security_request_handler(struct k_work *work)
 {
 	uint8_t device_id = (work == &security_request_work[0].work) ? 0 : 1;
@@ -157,6 +382,7 @@ static void security_request_handler(struct k_work *work)
 
 	if (ctx->state == CONN_STATE_CONNECTED)
 	{
+		ble_manager_pairing_started(device_id);
 		devices_manager_set_device_state(ctx, CONN_STATE_PAIRING);
 	}
 }
@@ -179,6 +405,24 @@ void pairing_complete(struct bt_conn *conn, bool bonded)
 
 	devices_manager_set_device_state(ctx, CONN_STATE_PAIRED);
 
+	/* info.addr still holds the address we scanned, the bond is keyed by the identity address */
+	bt_addr_le_copy(&ctx->info.addr, bt_conn_get_dst(conn));
+
+	if (pairing_start_time[ctx->device_id])
+	{
+		LOG_INF("Pairing took %lld ms, key %s when it started [DEVICE ID %d]",
+				k_uptime_get() - pairing_start_time[ctx->device_id],
+				pairing_key_ready_at_start[ctx->device_id] ? "ready" : "generating",
+				ctx->device_id);
+		pairing_start_time[ctx->device_id] = 0;
+	}
+
+	if (BT_PAIRING_KEY_POLICY == BT_PAIRING_KEY_PER_PAIRING)
+	{
+		/* The next pairing gets a fresh key, and waits for it if it starts too soon */
+		ble_manager_watch_pairing_key();
+	}
+
 	if (ctx->info.is_new_device)
 	{
 		LOG_INF("New device paired successfully - saving bond [DEVICE ID %d]", ctx->device_id);
@@ -189,6 +433,7 @@ void pairing_complete(struct bt_conn *conn, bool bonded)
 
 		devices_manager_update_bonded_devices_collection();
 		devices_manager_get_bonded_devices_collection(bonded_devices);
+		ble_manager_load_accept_list();
 	}
 	else
 	{
@@ -314,12 +559,49 @@ int ble_manager_disconnect_device(struct bt_conn *conn)
 static void connected_cb(struct bt_conn *conn, uint8_t err)
 {
 	struct device_context *ctx = devices_manager_get_device_context_by_conn(conn);
+	if (!ctx && auto_connect_pending)
+	{
+		auto_connect_pending = false;
+		if (err)
+		{
+			LOG_ERR("Accept list connection failed (err 0x%02X)", err);
+			for (uint8_t i = 0; i < 2; i++)
+			{
+				if (reconnect[i].active && !device_ctx[i].conn)
+				{
+					ble_manager_schedule_reconnect(i);
+				}
+			}
+			return;
+		}
+
+		/* The controller resolved the peer's RPA, so the identity address tells us which HI it is */
+		ctx = devices_manager_get_device_context_by_addr(bt_conn_get_dst(conn));
+		if (ctx)
+		{
+			ctx->conn = bt_conn_ref(conn);
+		}
+	}
+
 	if (!ctx)
 	{
 		LOG_DBG("Using first slot for new connection");
 		ctx = &device_ctx[0];
 	}
 
+	if (err && reconnect[ctx->device_id].active)
+	{
+		LOG_WRN("Reconnection attempt %d failed (err 0x%02X) [DEVICE ID %d]",
+				reconnect[ctx->device_id].attempts, err, ctx->device_id);
+		if (ctx->conn)
+		{
+			bt_conn_unref(ctx->conn);
+			ctx->conn = NULL;
+		}
+		ble_manager_schedule_reconnect(ctx->device_id);
+		return;
+	}
+
 	if (err)
 	{
 		LOG_ERR("Connection failed (err 0x%02X)", err);
@@ -335,6 +617,10 @@ static void connected_cb(struct bt_conn *conn, uint8_t err)
 	ctx->conn = conn;
 	bt_addr_le_copy(&ctx->info.addr, addr);
 
+	/* CONFIG_BT_GATT_AUTO_UPDATE_MTU starts the exchange, preset reads wait for it */
+	mtu_ready[ctx->device_id] = false;
+	k_work_reschedule(&mtu_wait_work[ctx->device_id], K_MSEC(BT_MTU_EXCHANGE_WAIT_MS));
+
 	/* Show connected status on display */
 	display_manager_show_status("Connected");
 
@@ -343,12 +629,33 @@ static void connected_cb(struct bt_conn *conn, uint8_t err)
 		LOG_DBG("Connected to new device %s - expecting pairing [DEVICE ID %d]", addr_str,
 				ctx->device_id);
 		devices_manager_set_device_state(ctx, CONN_STATE_CONNECTED);
+		/* Covers pairings the HI starts itself, our security request restarts the clock */
+		ble_manager_pairing_started(ctx->device_id);
 	}
 	else
 	{
 		LOG_INF("Connected to bonded (or bonding) device %s [DEVICE ID %d]", addr_str,
 				ctx->device_id);
+		LOG_INF("Reconnected in %lld ms, %ld advertising report(s) reached the host, "
+				"%ld connection initiation(s) [DEVICE ID %d]",
+				k_uptime_get() - reconnect_stats[ctx->device_id].start_time,
+				atomic_get(&host_adv_reports) - reconnect_stats[ctx->device_id].adv_reports,
+				atomic_get(&conn_initiations) - reconnect_stats[ctx->device_id].initiations,
+				ctx->device_id);
+		if (reconnect[ctx->device_id].active)
+		{
+			LOG_INF("Link restored after %d attempt(s) [DEVICE ID %d]",
+					reconnect[ctx->device_id].attempts, ctx->device_id);
+			reconnect[ctx->device_id].active = false;
+		}
 		app_controller_notify_device_connected(ctx->device_id);
+
+		/* The other HI may still be waiting for the accept list connection */
+		struct device_context *other = &device_ctx[ctx->device_id ^ 1];
+		if (other->state == CONN_STATE_BONDED && !other->conn)
+		{
+			k_work_schedule(&connect_work[other->device_id], K_NO_WAIT);
+		}
 	}
 
 	ble_cmd_request_security(ctx->device_id);
@@ -365,6 +672,8 @@ static void disconnected_cb(struct bt_conn *conn, uint8_t reason)
 	bt_conn_unref(ctx->conn);
 	ctx->conn = NULL;
 
+	link_manager_record_disconnect(ctx->device_id, reason);
+
 	// if (queue_is_active[ctx->device_id])
 	ble_cmd_queue_reset(ctx->device_id);
 
@@ -387,9 +696,26 @@ static void disconnected_cb(struct bt_conn *conn, uint8_t reason)
 	 * If the disconnection was unintentional, we simply set the state
 	 * to DISCONNECTED and wait for further instructions.
 	 */
+	if (reconnect[ctx->device_id].active)
+	{
+		LOG_WRN("Reconnection attempt %d lost (reason 0x%02X) [DEVICE ID %d]",
+				reconnect[ctx->device_id].attempts, reason, ctx->device_id);
+		ble_manager_schedule_reconnect(ctx->device_id);
+		return;
+	}
+
 	if (reason != BT_HCI_ERR_LOCALHOST_TERM_CONN && reason != BT_HCI_ERR_CONN_FAIL_TO_ESTAB)
 	{
 		LOG_WRN("Unintentional disconnection (reason 0x%02X) [DEVICE ID %d]", reason, ctx->device_id);
+
+		/* Keep the other HI's link and try to get this one back */
+		if ((ctx->state == CONN_STATE_READY || ctx->state == CONN_STATE_BONDED) &&
+			devices_manager_find_bonded_entry_by_addr(&ctx->info.addr, NULL))
+		{
+			ble_manager_schedule_reconnect(ctx->device_id);
+			return;
+		}
+
 		devices_manager_set_device_state(ctx, CONN_STATE_DISCONNECTED);
 		power_manager_power_off();
 		return;
@@ -403,8 +729,7 @@ static void disconnected_cb(struct bt_conn *conn, uint8_t reason)
 
 		LOG_DBG("Will attempt to switch address for reconnection [DEVICE ID %d]",
 				ctx->device_id);
-		struct scanned_device_entry *scanned_device = devices_manager_get_scanned_device(0);
-		if (!scanned_device)
+		if (devices_manager_get_best_scanned_device_idx() < 0)
 		{
 			LOG_ERR("Device not found in scanned devices list, cannot reconnect [DEVICE ID %d]", ctx->device_id);
 			return;
@@ -441,105 +766,311 @@ BT_CONN_CB_DEFINE(conn_callbacks) = {
 	.security_changed = security_changed_cb,
 };
 
-/* Device discovery function
-   Extracts device name and service UUID from advertisement data */
-static bool parse_adv(struct bt_data *data, void *user_data)
+/* GN Hearing HI service UUID, advertised by the NRPA of each HI */
+#define GN_HI_SERVICE_UUID 0xFEFE
+
+/* Fields of interest in an advertising report, pointing into the report buffer */
+struct adv_fields {
+	bool is_GN_HI;
+	const uint8_t *name;
+	uint8_t name_len;
+	const uint8_t *rsi;
+};
+
+/* Phase of the adaptive HI scan, see BT_SCAN_FAST_PHASE_MS */
+struct scan_phase {
+	uint16_t interval; // N * 0.625 ms
+	uint16_t window; // N * 0.625 ms
+	uint32_t duration_ms; // 0 = until the scan ends
+};
+
+static const struct scan_phase hi_scan_schedule[] = {
+	{BT_GAP_SCAN_FAST_INTERVAL_MIN, BT_GAP_SCAN_FAST_WINDOW, BT_SCAN_FAST_PHASE_MS},
+	{BT_GAP_SCAN_FAST_INTERVAL, BT_GAP_SCAN_FAST_WINDOW, BT_SCAN_MEDIUM_PHASE_MS},
+	{BT_GAP_SCAN_SLOW_INTERVAL_1, BT_GAP_SCAN_SLOW_WINDOW_1, 0}, // BT_LE_SCAN_ACTIVE_CAP_RAP timing
+};
+
+/* Advertising report statistics for the current HI scan */
+static struct {
+	int64_t start_time;
+	int64_t first_match_time;
+	int64_t phase_start;
+	uint8_t phase;
+	uint32_t phase_time_ms[ARRAY_SIZE(hi_scan_schedule)];
+	uint32_t reports;
+	uint32_t matches;
+	uint64_t cycles_total;
+	uint32_t cycles_max;
+} scan_stats;
+
+/**
+ * @brief Walk the AD structures of a report in a single pass
+ *
+ * Nothing is copied, formatted or logged here; the fields only point into @p ad.
+ * For 16-bit service data only the leading UUID is compared, the rest is payload.
+ *
+ * @param ad Raw advertising data
+ * @param fields Output fields
+ */
+static void parse_adv(const struct net_buf_simple *ad, struct adv_fields *fields)
 {
-	struct scan_callback_data *scan_data = (struct scan_callback_data *)user_data;
-	char addr_str[BT_ADDR_LE_STR_LEN];
-	bt_addr_le_to_str(&scan_data->addr, addr_str, sizeof(addr_str));
-	
-	// LOG_DBG("Advertisement data type 0x%X len %u from %s", data->type, data->data_len, addr_str);
+	const uint8_t *data = ad->data;
+	uint16_t len = ad->len;
 
-	switch (data->type)
+	while (len > 1)
 	{
-	case BT_DATA_UUID16_SOME:
-	case BT_DATA_UUID16_ALL:
-	case BT_DATA_SVC_DATA16:
-		if (data->data_len >= 2)
+		uint8_t field_len = data[0];
+		if (field_len == 0 || field_len >= len)
 		{
-			for (size_t i = 0; i <= data->data_len - 2; i += 2)
-			{
-				uint16_t uuid_val = sys_get_le16(&data->data[i]);
-				LOG_DBG("Service Data UUID 0x%04X", uuid_val);
+			break; // Padding or malformed AD structure
+		}
+
+		uint8_t ad_type = data[1];
+		const uint8_t *value = &data[2];
+		uint8_t value_len = field_len - 1;
 
-				if (uuid_val == 0xFEFE)
+		switch (ad_type)
+		{
+		case BT_DATA_UUID16_SOME:
+		case BT_DATA_UUID16_ALL:
+			for (uint8_t i = 0; i + 1 < value_len; i += 2)
+			{
+				if (sys_get_le16(&value[i]) == GN_HI_SERVICE_UUID)
 				{
-					LOG_INF("Found GN Hearing HI service UUID from %s", addr_str);
-					// LOG_HEXDUMP_DBG(data->data, data->data_len, "Service Data");
-					scan_data->is_GN_HI = true;
+					fields->is_GN_HI = true;
+					break;
 				}
 			}
-		}
-		break;
+			break;
 
-	case BT_DATA_NAME_COMPLETE:
-	case BT_DATA_NAME_SHORTENED:
-		char name[BT_NAME_MAX_LEN];
-		memset(name, 0, sizeof(name));
-		strncpy(name, (char *)data->data, MIN(data->data_len, BT_NAME_MAX_LEN - 1));
-		scan_data->name[0] = '\0';
-		strncat(scan_data->name, name, BT_NAME_MAX_LEN - 1);
-		break;
+		case BT_DATA_SVC_DATA16:
+			if (value_len >= 2 && sys_get_le16(value) == GN_HI_SERVICE_UUID)
+			{
+				fields->is_GN_HI = true;
+			}
+			break;
 
-	default:
-		return true;
-	}
+		case BT_DATA_NAME_COMPLETE:
+		case BT_DATA_NAME_SHORTENED:
+			fields->name = value;
+			fields->name_len = value_len;
+			break;
 
-	return true;
+		case BT_DATA_CSIS_RSI:
+			if (value_len == CSIP_RSI_SIZE)
+			{
+				fields->rsi = value;
+			}
+			break;
+
+		default:
+			break;
+		}
+
+		data += field_len + 1;
+		len -= field_len + 1;
+	}
 }
 
-static void advertisement_found_cb(const bt_addr_le_t *addr, int8_t rssi, uint8_t type, struct net_buf_simple *ad)
+static void process_adv_report(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
+							   struct net_buf_simple *ad)
 {
-	// LOG_DBG("Recevied adv type %u from %s, RSSI %d dBm, AD len %u", type, addr_str, rssi, ad->len);
+	struct adv_fields fields = {0};
 
-	char addr_str[BT_ADDR_LE_STR_LEN];
-	bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
+	parse_adv(ad, &fields);
 
-	if (type != BT_GAP_ADV_TYPE_EXT_ADV) {
-		// LOG_DBG("Received adv from %s, RSSI %d dBm, EAD len %u", addr_str, rssi, ad->len);
-		return;
-	} else {
-		// LOG_DBG("Received extended adv from %s, RSSI %d dBm, EXT_AD len %u", addr_str, rssi, ad->len);
+	/**
+	 * Keep every RSI, so the other set member can be matched against the SIRK right
+	 * after CSIP discovery, without a dedicated RSI scan. The other ear sends its RSI
+	 * in legacy advertisements from its RPA, which is not in the scanned devices list.
+	 */
+	if (fields.rsi)
+	{
+		devices_manager_store_scanned_rsi(addr, fields.rsi);
 	}
 
-	int err;
-
-	struct scan_callback_data scan_data = {0};
-	scan_data.addr = *addr;
-	scan_data.rssi = rssi;
-	scan_data.is_GN_HI = false;
-	memset(scan_data.name, 0, sizeof(scan_data.name));
-
-	// Parse advertisement data to find service UUID and name
-	bt_data_parse(ad, parse_adv, &scan_data);
+	/* The HI service UUID and the name come in extended advertisements */
+	if (type != BT_GAP_ADV_TYPE_EXT_ADV)
+	{
+		return;
+	}
 
 	/**
 	 * Only the NRPA advertises the GN Hearing HI service UUID (0xFEFE).
 	 * If found, we add the device to the scanned devices list.
 	 */
-	if (scan_data.is_GN_HI)
+	if (fields.is_GN_HI)
 	{
-		int ret = devices_manager_add_scanned_device(&scan_data.addr,
-										   		  scan_data.rssi);
+		if (scan_stats.matches++ == 0)
+		{
+			scan_stats.first_match_time = k_uptime_get();
+		}
+
+		int ret = devices_manager_add_scanned_device(addr, rssi);
 		if (ret < 0)
 		{
+			char addr_str[BT_ADDR_LE_STR_LEN];
+			bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
 			LOG_ERR("Failed to add scanned device %s (err %d)", addr_str, ret);
 			return;
 		}
+
+		/**
+		 * Two stable candidates are a binaural pair, so there is nothing left to wait for.
+		 * With one, the other ear gets BT_SCAN_SETTLE_MS to show up before the scan ends.
+		 */
+		uint8_t stable = devices_manager_get_stable_scanned_device_count();
+		if (stable >= 2)
+		{
+			LOG_INF("Two stable HI candidates found, ending scan");
+			ble_manager_complete_scan_for_HIs();
+		}
+		else if (stable == 1)
+		{
+			k_work_schedule(&scan_settle_work, K_MSEC(BT_SCAN_SETTLE_MS));
+		}
 	}
 
 	/**
 	 * The advertisement may not contain the service UUID if it's the RPA,
-	 * but we will get the name as a scan response. So, we add the address to an existing entry - if any.
+	 * but we will get the name as a scan response. So, we add the name to an existing entry - if any.
 	 */
-	if (scan_data.name[0] != '\0')
+	if (fields.name)
 	{
-		err = devices_manager_update_scanned_device_name(&scan_data.addr, scan_data.name);
-		if (err)
+		char name[BT_NAME_MAX_LEN] = {0};
+		memcpy(name, fields.name, MIN(fields.name_len, BT_NAME_MAX_LEN - 1));
+		devices_manager_update_scanned_device_name(addr, name);
+	}
+}
+
+static void advertisement_found_cb(const bt_addr_le_t *addr, int8_t rssi, uint8_t type, struct net_buf_simple *ad)
+{
+	uint32_t start = k_cycle_get_32();
+
+	process_adv_report(addr, rssi, type, ad);
+
+	uint32_t cycles = k_cycle_get_32() - start;
+	scan_stats.reports++;
+	scan_stats.cycles_total += cycles;
+	scan_stats.cycles_max = MAX(scan_stats.cycles_max, cycles);
+}
+
+static void scan_stats_print(void)
+{
+	if (scan_stats.reports == 0)
+	{
+		return;
+	}
+
+	LOG_INF("Scan: %u reports, %u HI matches, %u us/report avg, %u us max",
+			scan_stats.reports, scan_stats.matches,
+			k_cyc_to_us_floor32((uint32_t)(scan_stats.cycles_total / scan_stats.reports)),
+			k_cyc_to_us_floor32(scan_stats.cycles_max));
+}
+
+/* Add the time spent in the current phase, once per phase */
+static void scan_phase_account(void)
+{
+	if (scan_stats.phase_start == 0)
+	{
+		return;
+	}
+
+	scan_stats.phase_time_ms[scan_stats.phase] += k_uptime_get() - scan_stats.phase_start;
+	scan_stats.phase_start = 0;
+}
+
+/**
+ * @brief Report time to discover and the estimated radio energy of the HI scan
+ *
+ * Radio on time is estimated from the time spent in each phase and its duty cycle.
+ */
+static void scan_energy_print(void)
+{
+	uint32_t radio_on_ms = 0;
+
+	for (uint8_t i = 0; i < ARRAY_SIZE(hi_scan_schedule); i++)
+	{
+		const struct scan_phase *phase = &hi_scan_schedule[i];
+		if (scan_stats.phase_time_ms[i] == 0)
 		{
-			LOG_ERR("Failed to update scanned device name %s (err %d)", addr_str, err);
+			continue;
 		}
+
+		uint32_t on_ms = scan_stats.phase_time_ms[i] * phase->window / phase->interval;
+		LOG_INF("  Phase %d: %u ms at %u%% duty, radio on ~%u ms", i,
+				scan_stats.phase_time_ms[i], phase->window * 100 / phase->interval, on_ms);
+		radio_on_ms += on_ms;
+	}
+
+	if (scan_stats.first_match_time)
+	{
+		LOG_INF("HI scan: first HI after %lld ms, radio on ~%u ms, ~%u uC",
+				scan_stats.first_match_time - scan_stats.start_time, radio_on_ms,
+				radio_on_ms * BT_SCAN_RX_CURRENT_UA / 1000);
+	}
+	else
+	{
+		LOG_INF("HI scan: no HI found, radio on ~%u ms, ~%u uC", radio_on_ms,
+				radio_on_ms * BT_SCAN_RX_CURRENT_UA / 1000);
+	}
+}
+
+static int hi_scan_start_phase(uint8_t phase_idx)
+{
+	const struct scan_phase *phase = &hi_scan_schedule[phase_idx];
+	struct bt_le_scan_param param = {
+		.type = BT_LE_SCAN_TYPE_ACTIVE,
+		.options = BT_LE_SCAN_OPT_NONE,
+		.interval = phase->interval,
+		.window = phase->window,
+	};
+
+	int err = bt_le_scan_start(&param, advertisement_found_cb);
+	if (err)
+	{
+		return err;
+	}
+
+	scan_stats.phase = phase_idx;
+	scan_stats.phase_start = k_uptime_get();
+
+	if (phase->duration_ms)
+	{
+		k_work_schedule(&scan_phase_work, K_MSEC(phase->duration_ms));
+	}
+
+	LOG_INF("HI scan phase %d: %u%% duty cycle", phase_idx, phase->window * 100 / phase->interval);
+	return 0;
+}
+
+/* Back off to the next phase of the schedule if no HI has been seen yet */
+static void scan_phase_work_handler(struct k_work *work)
+{
+	if (!atomic_get(&hi_scan_active))
+	{
+		return;
+	}
+
+	/* Keep the duty cycle while a seen HI is becoming a stable candidate */
+	if (devices_manager_get_scanned_device_count() > 0)
+	{
+		k_work_schedule(&scan_phase_work, K_MSEC(hi_scan_schedule[scan_stats.phase].duration_ms));
+		return;
+	}
+
+	int err = bt_le_scan_stop();
+	if (err || !atomic_get(&hi_scan_active))
+	{
+		return;
+	}
+
+	scan_phase_account();
+
+	err = hi_scan_start_phase(scan_stats.phase + 1);
+	if (err)
+	{
+		LOG_ERR("Failed to start next HI scan phase (err %d)", err);
 	}
 }
 
@@ -554,131 +1085,404 @@ void ble_manager_start_scan_for_HIs(void)
 		return;
 	}
 
-	// Clear any previous scanned devices
-	devices_manager_clear_scanned_devices();
+	// Clear any previous scanned devices
+	devices_manager_clear_scanned_devices();
+	memset(&scan_stats, 0, sizeof(scan_stats));
+
+	// bt_conn_unref(device_ctx->conn);
+	// device_ctx->conn = NULL;
+
+	/* Show searching indicator on display */
+	display_manager_show_status("Searching...");
+
+	scan_stats.start_time = k_uptime_get();
+	atomic_set(&hi_scan_active, 1);
+
+	err = hi_scan_start_phase(0);
+	if (err)
+	{
+		atomic_set(&hi_scan_active, 0);
+		LOG_ERR("Scanning failed to start (err %d)", err);
+		display_manager_show_status("Scan failed");
+		return;
+	}
+
+	LOG_INF("Scanning for HIs");
+}
+
+void ble_manager_stop_scan_for_HIs(void)
+{
+	atomic_set(&hi_scan_active, 0);
+	k_work_cancel_delayable(&scan_settle_work);
+	k_work_cancel_delayable(&scan_phase_work);
+
+	int err = bt_le_scan_stop();
+	if (err)
+	{
+		LOG_ERR("Stopping scan failed (err %d)", err);
+		return;
+	}
+
+	LOG_INF("Scan stopped");
+
+	if (scan_stats.phase_start)
+	{
+		scan_phase_account();
+		scan_stats_print();
+		scan_energy_print();
+	}
+}
+
+/**
+ * @brief End the HI scan early and notify the app controller, once per scan
+ */
+void ble_manager_complete_scan_for_HIs(void)
+{
+	if (!atomic_cas(&hi_scan_active, 1, 0))
+	{
+		return; // Already stopped or completed
+	}
+
+	LOG_INF("HI scan completed after %lld ms", k_uptime_get() - scan_stats.start_time);
+	ble_manager_stop_scan_for_HIs();
+	app_controller_notify_scan_complete();
+}
+
+static void scan_settle_work_handler(struct k_work *work)
+{
+	LOG_INF("Stable HI candidate found, ending scan");
+	ble_manager_complete_scan_for_HIs();
+}
+
+/**
+ * @brief Connect to a device by index in scanned devices list
+ *
+ * @param device_id Device ID (0 or 1)
+ * @param idx Index in scanned devices list
+ * @return 0 on success, negative error code on failure
+ */
+int ble_manager_connect_to_scanned_device(uint8_t device_id, uint8_t idx)
+{
+	struct scanned_device_entry *scanned_device = devices_manager_get_scanned_device(idx);
+	if (!scanned_device)
+	{
+		LOG_ERR("Invalid scanned device index %d", idx);
+		return -EINVAL;
+	}
+
+	struct device_context *ctx = devices_manager_get_device_context_by_id(device_id);
+	if (!ctx)
+	{
+		LOG_ERR("No device context found for id %d", device_id);
+		return -EINVAL;
+	}
+
+	// Populate device info
+	bt_addr_le_copy(&ctx->info.addr, &scanned_device->addr);
+	ctx->info.is_new_device = true;
+	// return ble_manager_connect(device_id, &scanned_device->addr);
+	k_work_schedule(&connect_work[ctx->device_id], K_MSEC(0));
+	return 0;
+}
+
+/** Initialize BLE manager
+ * @brief Sets up connection callbacks, authentication, VCP controller, and battery reader
+ *
+ * @return 0 on success, negative error code on failure
+ */
+int ble_manager_init(void)
+{
+	bt_conn_auth_info_cb_register(&auth_info_callbacks);
+
+	int err = ble_queues_init();
+	if (err)
+	{
+		LOG_ERR("BLE queue init failed (err %d)", err);
+		return err;
+	}
+
+	LOG_DBG("Initializing security & connection works");
+	for (ssize_t i = 0; i < 2; i++)
+	{
+		k_work_init_delayable(&security_request_work[i], security_request_handler);
+		k_work_init_delayable(&connect_work[i], connect_work_handler);
+	}
+	k_work_init_delayable(&scan_settle_work, scan_settle_work_handler);
+	k_work_init_delayable(&scan_phase_work, scan_phase_work_handler);
+	bt_le_scan_cb_register(&scan_listener);
+	bt_gatt_cb_register(&gatt_callbacks);
+	link_manager_init();
+
+	err = devices_manager_init();
+	if (err)
+	{
+		LOG_ERR("Devices manager init failed (err %d)", err);
+		return err;
+	}
+
+	bonded_devices = (struct bond_collection *)k_calloc(1, sizeof(struct bond_collection));
+	if (!bonded_devices)
+	{
+		LOG_ERR("Failed to allocate memory for bonded devices");
+		k_free(device_ctx);
+		return -ENOMEM;
+	}
+	err = devices_manager_get_bonded_devices_collection(bonded_devices);
+	if (err)
+	{
+		LOG_ERR("Failed to get bonded devices collection (err %d)", err);
+		return err;
+	}
+
+	LOG_INF("BLE manager and subsystems initialized");
+	return 0;
+}
+
+/* Reconnect work handler - performs the actual connection with delay */
+static bool conn_is_connecting(struct bt_conn *conn)
+{
+	struct bt_conn_info info;
+
+	if (!conn || bt_conn_get_info(conn, &info))
+	{
+		return false;
+	}
+
+	return info.state == BT_CONN_STATE_CONNECTING;
+}
+
+/* Scan-then-connect, BT_RECONNECT_SCAN: connect to the first bonded HI that advertises */
+static void reconnect_scan_cb(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
+							  struct net_buf_simple *ad)
+{
+	if (type != BT_GAP_ADV_TYPE_ADV_IND && type != BT_GAP_ADV_TYPE_ADV_DIRECT_IND)
+	{
+		return;
+	}
+
+	/* The controller reports the identity address of peers it resolved */
+	struct device_context *ctx = devices_manager_get_device_context_by_addr(addr);
+	if (!ctx || ctx->state != CONN_STATE_BONDED || ctx->conn)
+	{
+		return;
+	}
+
+	LOG_DBG("Bonded HI advertising, connecting [DEVICE ID %d]", ctx->device_id);
+	int err = ble_manager_connect(ctx->device_id, addr);
+	if (err && reconnect[ctx->device_id].active)
+	{
+		ble_manager_schedule_reconnect(ctx->device_id);
+	}
+}
+
+static void connect_work_handler(struct k_work *work)
+{
+	struct device_context *ctx =
+		(work == &connect_work[0].work) ? &device_ctx[0] : &device_ctx[1];
+
+	char addr_str[BT_ADDR_LE_STR_LEN];
+	bt_addr_le_to_str(&ctx->info.addr, addr_str, sizeof(addr_str));
+
+	LOG_DBG("Connect work executing for %s [DEVICE ID %d]", addr_str, ctx->device_id);
+
+	/**
+	 * Only one connection can be initiated at a time. If the other HI is already being
+	 * connected, connected_cb() reschedules this work once that connection is up.
+	 */
+	struct device_context *other = &device_ctx[ctx->device_id ^ 1];
+	if (auto_connect_pending || conn_is_connecting(other->conn))
+	{
+		LOG_DBG("Connection already being initiated, deferring [DEVICE ID %d]", ctx->device_id);
+		return;
+	}
+
+	if (BT_RECONNECT_POLICY == BT_RECONNECT_SCAN && ctx->state == CONN_STATE_BONDED)
+	{
+		int err = bt_le_scan_start(BT_LE_SCAN_PASSIVE, reconnect_scan_cb);
+		if (err && err != -EALREADY)
+		{
+			LOG_ERR("Failed to start reconnect scan (err %d) [DEVICE ID %d]", err,
+					ctx->device_id);
+			if (reconnect[ctx->device_id].active)
+			{
+				ble_manager_schedule_reconnect(ctx->device_id);
+			}
+		}
+		return;
+	}
+
+	/**
+	 * While both bonded HIs are waiting, connect to whichever the controller finds first
+	 * on the accept list. Once one is connected, the other is connected directly.
+	 */
+	if (ctx->state == CONN_STATE_BONDED && other->state == CONN_STATE_BONDED && !other->conn &&
+		accept_list_count > 1)
+	{
+		ble_manager_auto_connect();
+		return;
+	}
+
+	int err = ble_manager_connect(ctx->device_id, &ctx->info.addr);
+	if (err && reconnect[ctx->device_id].active)
+	{
+		ble_manager_schedule_reconnect(ctx->device_id);
+	}
+}
+
+/**
+ * @brief Schedule the next attempt to reconnect a HI after link loss
+ *
+ * The first call starts the reconnection budget. Each attempt doubles the backoff up to
+ * BT_RECONNECT_BACKOFF_MAX_MS. When the budget is spent the device is powered off.
+ *
+ * @param device_id Device ID of the lost HI
+ */
+static void ble_manager_schedule_reconnect(uint8_t device_id)
+{
+	struct device_context *ctx = &device_ctx[device_id];
+
+	if (!reconnect[device_id].active)
+	{
+		reconnect[device_id].active = true;
+		reconnect[device_id].attempts = 0;
+		reconnect[device_id].start_time = k_uptime_get();
+		reconnect_stats[device_id].start_time = reconnect[device_id].start_time;
+		reconnect_stats[device_id].adv_reports = atomic_get(&host_adv_reports);
+		reconnect_stats[device_id].initiations = atomic_get(&conn_initiations);
+	}
+
+	int64_t elapsed = k_uptime_get() - reconnect[device_id].start_time;
+	if (reconnect[device_id].attempts >= BT_RECONNECT_MAX_ATTEMPTS ||
+		elapsed >= BT_RECONNECT_BUDGET_MS)
+	{
+		LOG_ERR("Giving up reconnecting after %d attempt(s) in %lld ms [DEVICE ID %d]",
+				reconnect[device_id].attempts, elapsed, device_id);
+		reconnect[device_id].active = false;
+		devices_manager_set_device_state(ctx, CONN_STATE_DISCONNECTED);
+		app_controller_notify_power_off();
+		return;
+	}
+
+	uint32_t delay_ms = MIN(BT_RECONNECT_BACKOFF_BASE_MS << reconnect[device_id].attempts,
+							BT_RECONNECT_BACKOFF_MAX_MS);
+	reconnect[device_id].attempts++;
+
+	/* ctx->info.addr holds the identity address, which the controller resolves the HI's RPA to */
+	devices_manager_set_device_state(ctx, CONN_STATE_BONDED);
+
+	LOG_INF("Reconnection attempt %d in %d ms [DEVICE ID %d]", reconnect[device_id].attempts,
+			delay_ms, device_id);
+	k_work_reschedule(&connect_work[device_id], K_MSEC(delay_ms));
+}
+
+bool ble_manager_is_reconnecting(void)
+{
+	return reconnect[0].active || reconnect[1].active;
+}
+
+/**
+ * @brief Stop all pending reconnections, e.g. before powering off
+ */
+void ble_manager_cancel_reconnect(void)
+{
+	for (uint8_t i = 0; i < 2; i++)
+	{
+		if (!reconnect[i].active)
+		{
+			continue;
+		}
+
+		reconnect[i].active = false;
+		k_work_cancel_delayable(&connect_work[i]);
 
-	// bt_conn_unref(device_ctx->conn);
-	// device_ctx->conn = NULL;
+		/* A pending connection never reaches disconnected_cb, so drop it here */
+		if (conn_is_connecting(device_ctx[i].conn))
+		{
+			bt_conn_disconnect(device_ctx[i].conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+			bt_conn_unref(device_ctx[i].conn);
+			device_ctx[i].conn = NULL;
+		}
 
-	/* Show searching indicator on display */
-	display_manager_show_status("Searching...");
+		devices_manager_set_device_state(&device_ctx[i], CONN_STATE_DISCONNECTED);
+	}
 
-	err = bt_le_scan_start(BT_LE_SCAN_ACTIVE_CONTINUOUS, advertisement_found_cb);
-	if (err)
+	if (auto_connect_pending)
 	{
-		LOG_ERR("Scanning failed to start (err %d)", err);
-		display_manager_show_status("Scan failed");
-		return;
+		bt_conn_create_auto_stop();
+		auto_connect_pending = false;
 	}
-
-	LOG_INF("Scanning for HIs");
 }
 
-void ble_manager_stop_scan_for_HIs(void)
+static void accept_list_add_bond_cb(const struct bt_bond_info *info, void *user_data)
 {
-	int err = bt_le_scan_stop();
+	char addr_str[BT_ADDR_LE_STR_LEN];
+	int err = bt_le_filter_accept_list_add(&info->addr);
 	if (err)
 	{
-		LOG_ERR("Stopping scan failed (err %d)", err);
+		bt_addr_le_to_str(&info->addr, addr_str, sizeof(addr_str));
+		LOG_WRN("Failed to add %s to accept list (err %d)", addr_str, err);
 		return;
 	}
 
-	LOG_INF("Scan stopped");
+	accept_list_count++;
 }
 
 /**
- * @brief Connect to a device by index in scanned devices list
+ * @brief Load the identity addresses of all bonded peers into the filter accept list
+ *
+ * The host hands the IRKs of bonded peers to the controller resolving list, so with the
+ * identity addresses on the accept list the controller matches the peers' RPAs by itself.
+ * The host is only woken up for the resulting connection, not for every advertisement.
  *
- * @param device_id Device ID (0 or 1)
- * @param idx Index in scanned devices list
  * @return 0 on success, negative error code on failure
  */
-int ble_manager_connect_to_scanned_device(uint8_t device_id, uint8_t idx)
+int ble_manager_load_accept_list(void)
 {
-	struct scanned_device_entry *scanned_device = devices_manager_get_scanned_device(idx);
-	if (!scanned_device)
+	int err = bt_le_filter_accept_list_clear();
+	if (err)
 	{
-		LOG_ERR("Invalid scanned device index %d", idx);
-		return -EINVAL;
+		LOG_ERR("Failed to clear accept list (err %d)", err);
+		return err;
 	}
 
-	struct device_context *ctx = devices_manager_get_device_context_by_id(device_id);
-	if (!ctx)
-	{
-		LOG_ERR("No device context found for id %d", device_id);
-		return -EINVAL;
-	}
+	accept_list_count = 0;
+	bt_foreach_bond(BT_ID_DEFAULT, accept_list_add_bond_cb, NULL);
 
-	// Populate device info
-	bt_addr_le_copy(&ctx->info.addr, &scanned_device->addr);
-	ctx->info.is_new_device = true;
-	// return ble_manager_connect(device_id, &scanned_device->addr);
-	k_work_schedule(&connect_work[ctx->device_id], K_MSEC(0));
+	LOG_INF("Accept list loaded with %d bonded device(s)", accept_list_count);
 	return 0;
 }
 
-/** Initialize BLE manager
- * @brief Sets up connection callbacks, authentication, VCP controller, and battery reader
+/**
+ * @brief Connect to the first bonded peer on the accept list that the controller finds
  *
  * @return 0 on success, negative error code on failure
  */
-int ble_manager_init(void)
+static int ble_manager_auto_connect(void)
 {
-	bt_conn_auth_info_cb_register(&auth_info_callbacks);
-
-	int err = ble_queues_init();
-	if (err)
-	{
-		LOG_ERR("BLE queue init failed (err %d)", err);
-		return err;
-	}
-
-	LOG_DBG("Initializing security & connection works");
-	for (ssize_t i = 0; i < 2; i++)
+	if (auto_connect_pending)
 	{
-		k_work_init_delayable(&security_request_work[i], security_request_handler);
-		k_work_init_delayable(&connect_work[i], connect_work_handler);
+		return 0;
 	}
 
-	err = devices_manager_init();
-	if (err)
-	{
-		LOG_ERR("Devices manager init failed (err %d)", err);
+	int err = bt_le_scan_stop();
+	if (err) {
+		LOG_DBG("Failed to stop scan: %d", err);
 		return err;
 	}
 
-	bonded_devices = (struct bond_collection *)k_calloc(1, sizeof(struct bond_collection));
-	if (!bonded_devices)
-	{
-		LOG_ERR("Failed to allocate memory for bonded devices");
-		k_free(device_ctx);
-		return -ENOMEM;
-	}
-	err = devices_manager_get_bonded_devices_collection(bonded_devices);
+	err = bt_conn_le_create_auto(BT_CONN_LE_CREATE_CONN, BT_LE_CONN_PARAM_DEFAULT);
 	if (err)
 	{
-		LOG_ERR("Failed to get bonded devices collection (err %d)", err);
+		LOG_ERR("Failed to start accept list connection (err %d)", err);
 		return err;
 	}
 
-	LOG_INF("BLE manager and subsystems initialized");
+	auto_connect_pending = true;
+	atomic_inc(&conn_initiations);
+	LOG_DBG("Accept list connection started");
 	return 0;
 }
 
-/* Reconnect work handler - performs the actual connection with delay */
-static void connect_work_handler(struct k_work *work)
-{
-	struct device_context *ctx =
-		(work == &connect_work[0].work) ? &device_ctx[0] : &device_ctx[1];
-
-	char addr_str[BT_ADDR_LE_STR_LEN];
-	bt_addr_le_to_str(&ctx->info.addr, addr_str, sizeof(addr_str));
-
-	LOG_DBG("Connect work executing for %s [DEVICE ID %d]", addr_str, ctx->device_id);
-
-	ble_manager_connect(ctx->device_id, &ctx->info.addr);
-}
-
 int ble_manager_connect(uint8_t device_id, const bt_addr_le_t *addr)
 {
 	char addr_str[BT_ADDR_LE_STR_LEN];
@@ -706,6 +1510,7 @@ int ble_manager_connect(uint8_t device_id, const bt_addr_le_t *addr)
 		return err;
 	}
 
+	atomic_inc(&conn_initiations);
 	return 0;
 }
 
@@ -781,12 +1586,41 @@ int ble_manager_connect_to_bonded_device(uint8_t device_id)
 	bt_addr_le_to_str(&ctx->info.addr, addr_str, sizeof(addr_str));
 	LOG_DBG("Set device context to connect to, addr=%s [DEVICE ID %d]", addr_str, device_id);
 
+	reconnect_stats[device_id].start_time = k_uptime_get();
+	reconnect_stats[device_id].adv_reports = atomic_get(&host_adv_reports);
+	reconnect_stats[device_id].initiations = atomic_get(&conn_initiations);
+
 	// ble_manager_connect(ctx->device_id, &ctx->info.addr);
 	k_work_schedule(&connect_work[ctx->device_id], K_MSEC(250));
 
 	return 0;
 }
 
+static int settings_walk_cb(const char *key, size_t len, settings_read_cb read_cb,
+							void *cb_arg, void *param)
+{
+	return 0;
+}
+
+/* Times the loads done before the single pass, see SETTINGS_LOAD_MEASURE */
+static void settings_load_measure_old_path(void)
+{
+	uint32_t start = k_cycle_get_32();
+	settings_load();
+	uint32_t full_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+	start = k_cycle_get_32();
+	settings_load_subtree("bt");
+	uint32_t bt_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+	start = k_cycle_get_32();
+	settings_load_subtree_direct("harc/device", settings_walk_cb, NULL);
+	uint32_t walk_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+	LOG_INF("Old boot path: full load %u us, bt subtree %u us, %u us per record walk",
+			full_us, bt_us, walk_us);
+}
+
 void bt_ready_cb(int err)
 {
 	if (err)
@@ -797,18 +1631,35 @@ void bt_ready_cb(int err)
 
 	LOG_INF("Bluetooth initialized");
 
+	if (bt_pub_key_get())
+	{
+		LOG_INF("Pairing key already generated");
+	}
+	else
+	{
+		/* Started by the host in bt_enable(), runs alongside the settings load and scan */
+		ble_manager_watch_pairing_key();
+	}
+
 	if (IS_ENABLED(CONFIG_SETTINGS))
 	{
-		LOG_DBG("Loading BT settings from flash");
-		err = settings_load_subtree("bt");
+		uint32_t start = k_cycle_get_32();
+
+		/* One walk over NVS fills the host's bonds and every harc/ cache in RAM */
+		err = settings_load();
 		if (err)
 		{
-			LOG_WRN("Failed to load BT settings (err %d)", err);
+			LOG_WRN("Failed to load settings (err %d)", err);
 		}
-	}
 
-	LOG_DBG("Clearing filter accept list");
-	bt_le_filter_accept_list_clear();
+		LOG_INF("Settings loaded in one pass in %u us",
+			k_cyc_to_us_floor32(k_cycle_get_32() - start));
+
+		if (SETTINGS_LOAD_MEASURE)
+		{
+			settings_load_measure_old_path();
+		}
+	}
 
 	/* Initialize BLE manager */
 	err = ble_manager_init();
@@ -818,6 +1669,8 @@ void bt_ready_cb(int err)
 		return;
 	}
 
+	ble_manager_load_accept_list();
+
 	app_controller_notify_system_ready();
 }
 
@@ -910,7 +1763,7 @@ static int ble_cmd_execute(struct ble_cmd *cmd)
 		err = battery_discover(device_id);
 		break;
 	case BLE_CMD_BAS_READ_LEVEL:
-		err = battery_read_level(device_id);
+		err = battery_read_level(device_id, cmd);
 		break;
 
 	/* CSIP */
@@ -923,7 +1776,7 @@ static int ble_cmd_execute(struct ble_cmd *cmd)
 		err = has_cmd_discover(device_id);
 		break;
 	case BLE_CMD_HAS_READ_PRESETS:
-		err = has_cmd_read_presets(device_id);
+		err = has_cmd_read_presets(device_id, cmd);
 		break;
 	case BLE_CMD_HAS_SET_PRESET:
 		err = has_cmd_set_active_preset(device_id, d0);
@@ -935,6 +1788,14 @@ static int ble_cmd_execute(struct ble_cmd *cmd)
 		err = has_cmd_prev_preset(device_id);
 		break;
 
+	/* GATT cache */
+	case BLE_CMD_GATT_VALIDATE:
+		err = gatt_cache_cmd_validate(device_id);
+		break;
+	case BLE_CMD_DIS_READ:
+		err = gatt_cache_cmd_read_dis(device_id);
+		break;
+
 	default:
 		LOG_ERR("Unknown BLE command type: %d", type);
 		err = -EINVAL;
@@ -978,6 +1839,7 @@ static void ble_cmd_timeout_handler(struct k_work *work)
 	else
 	{
 		LOG_ERR("BLE command timeout (safety net): type=%d", ctx->current_ble_cmd->type);
+		link_manager_record_cmd_timeout(ctx->device_id);
 
 		// Free the command and move on
 		ble_cmd_free(ctx->current_ble_cmd);
@@ -1007,6 +1869,7 @@ void ble_cmd_complete(uint8_t device_id, int err)
 	if (err)
 	{
 		LOG_ERR("BLE command failed: type=%s, err=%d [DEVICE ID %d]", command_type_to_string(ctx->current_ble_cmd->type), err, device_id);
+		link_manager_record_cmd_error(device_id);
 		
 		if (ctx->current_ble_cmd->type == BLE_CMD_REQUEST_SECURITY && err == -1)
 		{
@@ -1042,6 +1905,12 @@ void ble_cmd_complete(uint8_t device_id, int err)
 	ctx->current_ble_cmd = NULL;
 	ble_cmd_in_progress[ctx->device_id] = false;
 
+	// A background command may be waiting for the profile this command used
+	if (!sys_slist_is_empty(&ble_bg_cmd_queue[ctx->device_id]))
+	{
+		k_work_submit(&ble_bg_cmd_work[ctx->device_id]);
+	}
+
 	// Process next command
 	if (!err)
 	{
@@ -1049,6 +1918,173 @@ void ble_cmd_complete(uint8_t device_id, int err)
 	}
 }
 
+static struct ble_cmd *ble_bg_cmd_get(uint8_t device_id)
+{
+	k_spinlock_key_t key = k_spin_lock(&ble_bg_lock);
+	struct ble_cmd *cmd = ble_bg_cmd[device_id];
+	k_spin_unlock(&ble_bg_lock, key);
+
+	return cmd;
+}
+
+/**
+ * @brief Take the command out of the background lane
+ *
+ * @param device_id Device ID
+ * @param cmd Only take this command, or NULL for whichever command the lane holds
+ * @return The command taken, NULL if the lane does not hold it
+ */
+static struct ble_cmd *ble_bg_cmd_take(uint8_t device_id, struct ble_cmd *cmd)
+{
+	k_spinlock_key_t key = k_spin_lock(&ble_bg_lock);
+	struct ble_cmd *taken = ble_bg_cmd[device_id];
+
+	if (taken && cmd && taken != cmd)
+	{
+		taken = NULL;
+	}
+	if (taken)
+	{
+		ble_bg_cmd[device_id] = NULL;
+	}
+	k_spin_unlock(&ble_bg_lock, key);
+
+	return taken;
+}
+
+/**
+ * @brief Mark a command as complete, in whichever lane it runs
+ *
+ * Used by the callbacks of commands that can run in the background lane. The lane is
+ * found by the command itself, so two commands of the same type in both lanes do not
+ * complete each other. Completions of commands that already ended are ignored.
+ *
+ * @param device_id Device ID
+ * @param cmd Command handed to the module when it was executed
+ * @param err 0 on success, error code on failure
+ */
+void ble_cmd_complete_cmd(uint8_t device_id, struct ble_cmd *cmd, int err)
+{
+	if (!cmd)
+	{
+		return;
+	}
+
+	if (!ble_bg_cmd_take(device_id, cmd))
+	{
+		if (device_ctx[device_id].current_ble_cmd == cmd)
+		{
+			ble_cmd_complete(device_id, err);
+		}
+		else
+		{
+			LOG_DBG("Ignoring completion of a command that already ended [DEVICE ID %d]",
+					device_id);
+		}
+		return;
+	}
+
+	enum ble_cmd_type type = cmd->type;
+
+	k_work_cancel_delayable(&ble_bg_cmd_timeout_work[device_id]);
+
+	if (err)
+	{
+		LOG_ERR("Background BLE command failed: type=%s, err=%d [DEVICE ID %d]",
+				command_type_to_string(type), err, device_id);
+		link_manager_record_cmd_error(device_id);
+	}
+	else
+	{
+		LOG_DBG("Background BLE command completed: type=%s [DEVICE ID %d]",
+				command_type_to_string(type), device_id);
+	}
+
+	ble_cmd_free(cmd);
+
+	/* Run the next background command, and any interactive command deferred on it */
+	k_work_submit(&ble_bg_cmd_work[device_id]);
+	k_sem_give(ble_cmd_sem[device_id]);
+}
+
+static void ble_bg_cmd_work_handler(struct k_work *work)
+{
+	uint8_t device_id = (work == &ble_bg_cmd_work[0]) ? 0 : 1;
+
+	while (!ble_bg_cmd_get(device_id))
+	{
+		k_mutex_lock(&ble_queue_mutex[device_id], K_FOREVER);
+		sys_snode_t *node = sys_slist_get(&ble_bg_cmd_queue[device_id]);
+		k_mutex_unlock(&ble_queue_mutex[device_id]);
+
+		if (!node)
+		{
+			return;
+		}
+
+		struct ble_cmd *cmd = CONTAINER_OF(node, struct ble_cmd, node);
+		enum ble_cmd_type type = cmd->type;
+
+		if (!ble_cmd_mtu_check(cmd))
+		{
+			k_mutex_lock(&ble_queue_mutex[device_id], K_FOREVER);
+			sys_slist_prepend(&ble_bg_cmd_queue[device_id], &cmd->node);
+			k_mutex_unlock(&ble_queue_mutex[device_id]);
+			return;
+		}
+
+		k_spinlock_key_t key = k_spin_lock(&ble_bg_lock);
+		ble_bg_cmd[device_id] = cmd;
+		k_spin_unlock(&ble_bg_lock, key);
+		link_manager_notify_activity();
+
+		/* Armed first, the command may complete before ble_cmd_execute() returns */
+		k_work_schedule(&ble_bg_cmd_timeout_work[device_id], K_MSEC(BLE_CMD_TIMEOUT_MS));
+
+		int err = ble_cmd_execute(cmd);
+		if (!err || !ble_bg_cmd_take(device_id, cmd))
+		{
+			/* In flight, or already completed from within ble_cmd_execute() */
+			continue;
+		}
+
+		k_work_cancel_delayable(&ble_bg_cmd_timeout_work[device_id]);
+
+		if (err == -EBUSY && device_ctx[device_id].current_ble_cmd)
+		{
+			/* The interactive command holds the profile, retry once it completes */
+			LOG_DBG("Deferring background %s [DEVICE ID %d]", command_type_to_string(type),
+					device_id);
+			k_mutex_lock(&ble_queue_mutex[device_id], K_FOREVER);
+			sys_slist_prepend(&ble_bg_cmd_queue[device_id], &cmd->node);
+			k_mutex_unlock(&ble_queue_mutex[device_id]);
+			return;
+		}
+
+		LOG_ERR("Failed to initiate background BLE command %s (err %d) [DEVICE ID %d]",
+				command_type_to_string(type), err, device_id);
+		ble_cmd_free(cmd);
+	}
+}
+
+static void ble_bg_cmd_timeout_handler(struct k_work *work)
+{
+	uint8_t device_id = (work == &ble_bg_cmd_timeout_work[0].work) ? 0 : 1;
+	struct ble_cmd *cmd = ble_bg_cmd_take(device_id, NULL);
+
+	if (!cmd)
+	{
+		return;
+	}
+
+	LOG_ERR("Background BLE command timeout: type=%s [DEVICE ID %d]",
+			command_type_to_string(cmd->type), device_id);
+	link_manager_record_cmd_timeout(device_id);
+
+	ble_cmd_free(cmd);
+	k_work_submit(&ble_bg_cmd_work[device_id]);
+}
+
 /* Process the next command in the queue */
 static void ble_process_next_command(uint8_t device_id)
 {
@@ -1061,9 +2097,20 @@ static void ble_process_next_command(uint8_t device_id)
 		return;
 	}
 
+	if (!ble_cmd_mtu_check(cmd))
+	{
+		k_mutex_lock(&ble_queue_mutex[device_id], K_FOREVER);
+		sys_slist_prepend(&ble_cmd_queue[device_id], &cmd->node);
+		k_mutex_unlock(&ble_queue_mutex[device_id]);
+		return;
+	}
+
 	ctx->current_ble_cmd = cmd;
 	ble_cmd_in_progress[ctx->device_id] = true;
 
+	/* GATT traffic is coming, bring idle links back to the base rate */
+	link_manager_notify_activity();
+
 	uint8_t cmd_device_id = cmd->device_id;
 	enum ble_cmd_type type = cmd->type;
 	uint8_t d0 = cmd->d0;
@@ -1076,6 +2123,22 @@ static void ble_process_next_command(uint8_t device_id)
 		// Command failed to initiate
 		LOG_ERR("Failed to initiate BLE command (err %d) [DEVICE ID %d]", err, device_id);
 
+		if (err == -EBUSY && ble_bg_cmd_get(device_id))
+		{
+			/* The background command holds the profile, retry once it completes */
+			LOG_DBG("Deferring %s until background command completes [DEVICE ID %d]",
+					command_type_to_string(type), device_id);
+			link_manager_record_cmd_retry(device_id);
+
+			k_mutex_lock(&ble_queue_mutex[device_id], K_FOREVER);
+			sys_slist_prepend(&ble_cmd_queue[device_id], &cmd->node);
+			k_mutex_unlock(&ble_queue_mutex[device_id]);
+
+			ctx->current_ble_cmd = NULL;
+			ble_cmd_in_progress[ctx->device_id] = false;
+			return;
+		}
+
 		if (err == -EBUSY)
 		{
 			LOG_WRN("Server was busy: type=%s [DEVICE ID %d]", command_type_to_string(ctx->current_ble_cmd->type), device_id);
@@ -1089,6 +2152,7 @@ static void ble_process_next_command(uint8_t device_id)
 			case BLE_CMD_VCP_MUTE:
 			case BLE_CMD_VCP_UNMUTE:
 				LOG_DBG("Re-enqueuing VCP volume command at front of queue [DEVICE ID %d]", device_id);
+				link_manager_record_cmd_retry(device_id);
 				ble_cmd_enqueue(cmd, true);
 				break;
 
@@ -1344,7 +2408,7 @@ int ble_cmd_has_read_presets(uint8_t device_id, bool high_priority)
 
 int ble_cmd_has_set_preset(uint8_t device_id, uint8_t preset_index, bool high_priority)
 {
-	if (!presets_loaded) {
+	if (!device_ctx[device_id].has_ctlr.presets_read) {
 		ble_cmd_has_read_presets(device_id, true);
 	}
 
@@ -1384,7 +2448,7 @@ int ble_cmd_has_next_preset(uint8_t device_id, bool high_priority)
 
 int ble_cmd_has_prev_preset(uint8_t device_id, bool high_priority)
 {
-	if (!presets_loaded) {
+	if (!device_ctx[device_id].has_ctlr.presets_read) {
 		ble_cmd_has_read_presets(device_id, true);
 	}
 
@@ -1400,6 +2464,34 @@ int ble_cmd_has_prev_preset(uint8_t device_id, bool high_priority)
 	return ble_cmd_enqueue(cmd, high_priority);
 }
 
+int ble_cmd_gatt_validate(uint8_t device_id, bool high_priority)
+{
+	struct device_context *ctx = &device_ctx[device_id];
+	struct ble_cmd *cmd = ble_cmd_alloc(ctx->device_id);
+	if (!cmd)
+	{
+		return -ENOMEM;
+	}
+
+	cmd->device_id = ctx->device_id;
+	cmd->type = BLE_CMD_GATT_VALIDATE;
+	return ble_cmd_enqueue(cmd, high_priority);
+}
+
+int ble_cmd_dis_read(uint8_t device_id, bool high_priority)
+{
+	struct device_context *ctx = &device_ctx[device_id];
+	struct ble_cmd *cmd = ble_cmd_alloc(ctx->device_id);
+	if (!cmd)
+	{
+		return -ENOMEM;
+	}
+
+	cmd->device_id = ctx->device_id;
+	cmd->type = BLE_CMD_DIS_READ;
+	return ble_cmd_enqueue(cmd, high_priority);
+}
+
 /* Reset BLE command queue */
 void ble_cmd_queue_reset(uint8_t device_id)
 {
@@ -1425,6 +2517,22 @@ void ble_cmd_queue_reset(uint8_t device_id)
 	ble_cmd_in_progress[ctx->device_id] = false;
 	k_work_cancel_delayable(&ble_cmd_timeout_work[ctx->device_id]);
 
+	// Clear the background lane
+	k_mutex_lock(&ble_queue_mutex[ctx->device_id], K_FOREVER);
+	sys_snode_t *node;
+	while ((node = sys_slist_get(&ble_bg_cmd_queue[ctx->device_id])) != NULL)
+	{
+		ble_cmd_free(CONTAINER_OF(node, struct ble_cmd, node));
+	}
+	k_mutex_unlock(&ble_queue_mutex[ctx->device_id]);
+
+	k_work_cancel_delayable(&ble_bg_cmd_timeout_work[ctx->device_id]);
+	struct ble_cmd *bg_cmd = ble_bg_cmd_take(ctx->device_id, NULL);
+	if (bg_cmd)
+	{
+		ble_cmd_free(bg_cmd);
+	}
+
 	LOG_DBG("BLE command queue reset");
 }
 
@@ -1537,6 +2645,10 @@ static char *command_type_to_string(enum ble_cmd_type type)
 		return "BLE_CMD_HAS_NEXT_PRESET";
 	case BLE_CMD_HAS_PREV_PRESET:
 		return "BLE_CMD_HAS_PREV_PRESET";
+	case BLE_CMD_GATT_VALIDATE:
+		return "BLE_CMD_GATT_VALIDATE";
+	case BLE_CMD_DIS_READ:
+		return "BLE_CMD_DIS_READ";
 	default:
 		return "UNKNOWN_COMMAND";
 	}
@@ -1553,4 +2665,5 @@ void ble_manager_set_device_ctx_battery_level(struct bt_conn *conn, uint8_t leve
 	}
 
 	ctx->bas_ctlr.battery_level = level;
+	ctx->bas_ctlr.battery_level_updated = k_uptime_get();
 }
\ No newline at end of file
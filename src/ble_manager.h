@@ -5,6 +5,9 @@
 #include <zephyr/bluetooth/addr.h>
 #include <zephyr/bluetooth/bluetooth.h>
 #include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/att.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/l2cap.h>
 #include <zephyr/settings/settings.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/bluetooth/uuid.h>
@@ -26,17 +29,100 @@
             BT_GAP_SCAN_SLOW_INTERVAL_1, \
             BT_GAP_SCAN_SLOW_WINDOW_1)
 
+/**
+ * @brief Adaptive duty cycle for the first time HI search.
+ *
+ * The scan starts at 100 % duty cycle, drops to 50 % after BT_SCAN_FAST_PHASE_MS and to
+ * the @ref BT_LE_SCAN_ACTIVE_CAP_RAP timing after another BT_SCAN_MEDIUM_PHASE_MS, for as
+ * long as no HI has been seen. Duplicate filtering is off in every phase, so each report
+ * updates the smoothed RSSI of the scanned devices.
+ */
+#define BT_SCAN_FAST_PHASE_MS 2000
+#define BT_SCAN_MEDIUM_PHASE_MS 3000
+
+/* nRF52832 radio RX current at 1 Mbps with the DC/DC regulator, used for the scan energy estimate */
+#define BT_SCAN_RX_CURRENT_UA 5400
+
 #define MAX_DISCOVERED_DEVICES_MEMORY_SIZE 1024 // 1 KB
 #define BT_NAME_MAX_LEN 12
 #define BT_SECURITY_WANTED BT_SECURITY_L2
 #define BT_SCAN_TIMEOUT_MS 10000
 
+/* A scanned HI is a stable candidate once seen this often with at least this smoothed RSSI */
+#define BT_SCAN_STABLE_SEEN_COUNT 3
+#define BT_SCAN_STABLE_RSSI_DBM -75
+/* Time the other ear gets to show up once the first stable candidate is found */
+#define BT_SCAN_SETTLE_MS 1000
+
+/**
+ * @brief Reconnection after an unintentional link loss.
+ *
+ * The lost HI is reconnected with a backoff of BT_RECONNECT_BACKOFF_BASE_MS doubled per
+ * attempt and capped at BT_RECONNECT_BACKOFF_MAX_MS. Once BT_RECONNECT_MAX_ATTEMPTS
+ * attempts or BT_RECONNECT_BUDGET_MS have been spent, the device powers off.
+ */
+#define BT_RECONNECT_BACKOFF_BASE_MS 250
+#define BT_RECONNECT_BACKOFF_MAX_MS 8000
+#define BT_RECONNECT_MAX_ATTEMPTS 12
+#define BT_RECONNECT_BUDGET_MS 60000
+
+/**
+ * @brief How bonded HIs are found when reconnecting.
+ *
+ * With BT_RECONNECT_ACCEPT_LIST the controller matches the HIs' RPAs through its resolving
+ * list and accept list, and the host only sees the connection. BT_RECONNECT_SCAN is the
+ * scan-then-connect path, kept to compare against: the host scans, every advertising
+ * report wakes it up, and it connects once a report comes from a bonded HI. The reconnect
+ * log counts the advertising reports that reached the host either way.
+ */
+#define BT_RECONNECT_ACCEPT_LIST 0
+#define BT_RECONNECT_SCAN 1
+#define BT_RECONNECT_POLICY BT_RECONNECT_ACCEPT_LIST
+
+/**
+ * @brief When the local LE Secure Connections key pair is generated.
+ *
+ * The host starts generating its P-256 key pair in bt_enable(), while the settings load
+ * and the first scan run, and reuses it for every pairing of the boot. With
+ * BT_PAIRING_KEY_PREGEN that key serves both ears. BT_PAIRING_KEY_PER_PAIRING asks for a
+ * fresh key pair after each pairing, so a pairing that starts before it is ready waits for
+ * it, as it would with a key generated on demand. The pairing time log tells whether the
+ * key was ready when each pairing started, so both policies can be compared.
+ */
+#define BT_PAIRING_KEY_PER_PAIRING 0
+#define BT_PAIRING_KEY_PREGEN 1
+#define BT_PAIRING_KEY_POLICY BT_PAIRING_KEY_PREGEN
+
+/**
+ * @brief Time the boot loads that the single settings pass replaced, once, after the pass.
+ *
+ * Logs the full load main() used to do, the bt subtree load bt_ready_cb() did after it, and
+ * one NVS walk, which each cache used to pay per record on first use. Measurement builds
+ * only, it loads settings a second time.
+ */
+#define SETTINGS_LOAD_MEASURE 0
+
 /* CSIP Set Information */
 #define CSIP_SIRK_SIZE 16
+#define CSIP_RSI_SIZE 6
 
 /* Maximum number of presets to support */
 #define HAS_MAX_PRESETS 10
 
+/**
+ * @brief ATT MTU needed for the largest PDU the app receives.
+ *
+ * That is a HAS Preset Changed indication with a full preset name: ATT opcode and handle
+ * (3), then opcode, change ID, is_last, previous index, index and properties (6) and the
+ * name (BT_HAS_PRESET_NAME_MAX, which excludes the terminator). EATT bearers need an MTU
+ * of at least 64 anyway. CONFIG_BT_L2CAP_TX_MTU and CONFIG_BT_BUF_ACL_RX_SIZE are checked
+ * against this at build time, and preset reads wait up to BT_MTU_EXCHANGE_WAIT_MS for the
+ * MTU exchange.
+ */
+#define HAS_PRESET_CHANGED_MAX_LEN (6 + BT_HAS_PRESET_NAME_MAX)
+#define APP_ATT_MTU_MIN MAX(3 + HAS_PRESET_CHANGED_MAX_LEN, 64)
+#define BT_MTU_EXCHANGE_WAIT_MS 1000
+
 /* Struct to hold scan callback user data */
 struct scan_callback_data {
 	bt_addr_le_t addr;
@@ -51,6 +137,7 @@ struct bt_bas_ctlr {
     uint16_t battery_level_handle;
     uint16_t battery_level_ccc_handle;
     uint8_t battery_level;
+    int64_t battery_level_updated; /* k_uptime_get() of the last read or notification, 0 if none */
 };
 
 /* Preset information structure */
@@ -63,6 +150,7 @@ struct has_preset_info {
 
 struct bt_has_ctlr {
     struct bt_has *has;
+    uint8_t features; /* Hearing Aid Features value, read once and cached */
     uint8_t preset_count;
     uint8_t active_preset_index;
     struct has_preset_info presets[HAS_MAX_PRESETS];
@@ -104,6 +192,10 @@ enum ble_cmd_type {
     BLE_CMD_HAS_SET_PRESET,
     BLE_CMD_HAS_NEXT_PRESET,
     BLE_CMD_HAS_PREV_PRESET,
+
+    /* GATT cache commands */
+    BLE_CMD_GATT_VALIDATE,
+    BLE_CMD_DIS_READ,
 };
 
 /* BLE command structure */
@@ -127,10 +219,14 @@ void bt_ready_cb(int err);
 void ble_manager_set_device_ctx_battery_level(struct bt_conn *conn, uint8_t level);
 void ble_manager_start_scan_for_HIs(void);
 void ble_manager_stop_scan_for_HIs(void);
+void ble_manager_complete_scan_for_HIs(void);
 int ble_manager_connect_to_bonded_device(uint8_t device_id);
 int ble_manager_autoconnect_to_device_by_addr(uint8_t device_id,const bt_addr_le_t *addr);
 int ble_manager_connect_to_scanned_device(uint8_t device_id, uint8_t idx);
 void ble_manager_establish_trusted_bond(uint8_t device_id);
+int ble_manager_load_accept_list(void);
+bool ble_manager_is_reconnecting(void);
+void ble_manager_cancel_reconnect(void);
 
 
 /* BLE command queue API */
@@ -149,10 +245,26 @@ int ble_cmd_bas_read_level(uint8_t device_id, bool high_priority);
 
 int ble_cmd_csip_discover(uint8_t device_id, bool high_priority);
 
+int ble_cmd_gatt_validate(uint8_t device_id, bool high_priority);
+int ble_cmd_dis_read(uint8_t device_id, bool high_priority);
+
 void ble_cmd_queue_reset(uint8_t queue_id);
 
 void ble_cmd_complete(uint8_t device_id, int err);
 
+/**
+ * @brief Background command lane.
+ *
+ * Long reads that the user does not wait for (battery level, HAS preset list) run in a
+ * second lane per device, next to the interactive lane used for volume and preset
+ * changes. The lane is only used when the link has EATT bearers, so both commands can be
+ * in flight on separate ATT bearers. Without EATT every command uses the interactive lane.
+ * Commands that can run in either lane complete through ble_cmd_complete_cmd() with the
+ * command they were executed with.
+ */
+void ble_cmd_complete_cmd(uint8_t device_id, struct ble_cmd *cmd, int err);
+bool ble_cmd_use_background_bearer(uint8_t device_id);
+
 /* Connection management */
 extern struct bt_conn_cb conn_callbacks;
 extern struct bt_conn *auth_conn;
@@ -1,5 +1,6 @@
 #include "button_manager.h"
 #include "app_controller.h"
+#include "link_manager.h"
 
 LOG_MODULE_REGISTER(button_manager, LOG_LEVEL_INF);
 
@@ -165,6 +166,7 @@ void button1_pressed(const struct device *dev, struct gpio_callback *cb, uint32_
         return;
     }
     LOG_INF("Button 1 pressed - Volume Up");
+    link_manager_notify_activity();
     app_controller_notify_volume_up_button_pressed();
 }
 
@@ -174,6 +176,7 @@ void button2_pressed(const struct device *dev, struct gpio_callback *cb, uint32_
         return;
     }
     LOG_INF("Button 2 pressed - Volume Down");
+    link_manager_notify_activity();
     app_controller_notify_volume_down_button_pressed();
 }
 
@@ -192,6 +195,7 @@ void button4_pressed(const struct device *dev, struct gpio_callback *cb, uint32_
         return;
     }
     LOG_INF("Button 4 pressed - Next Preset");
+    link_manager_notify_activity();
     app_controller_notify_preset_button_pressed();
 }
 
@@ -3,6 +3,10 @@
 #include "devices_manager.h"
 #include "app_controller.h"
 
+/* Host internals, the public API has no way to resolve an RPA with a bonded peer's IRK */
+#include "host/keys.h"
+#include "common/rpa.h"
+
 LOG_MODULE_REGISTER(csip_coordinator, LOG_LEVEL_INF);
 
 static struct k_work_delayable rsi_scan_timeout_work;
@@ -20,10 +24,14 @@ struct csip_coordinator_context {
 
 static struct csip_coordinator_context csip_ctx[2];  // One per device
 
+/* True if the CSIS handles of the current discovery were injected from the cache */
+static bool handles_from_cache[CONFIG_BT_MAX_CONN];
+
 static struct rsi_scan_context {
 	bool active; // True if RSI scanning is active
 	int8_t device_id; // Device that is searching for other set member
 	bool rsi_found; // True if RSI advertisement matching SIRK was found
+	bt_addr_le_t match_addr; // Address of the matching set member, handed to the app controller
 	struct k_work_delayable scan_timeout_work; // RSI scanning must timeout after 10 seconds
 } rsi_scan_context = {
 	.active = false,
@@ -31,9 +39,126 @@ static struct rsi_scan_context {
 	.rsi_found = false,
 };
 
+/**
+ * RSI resolution cache. Resolving an RSI costs an AES operation, and an advertiser
+ * repeats the same RSI in every report until it rotates its address, so the result is
+ * kept per advertiser address and RSI. Results are only valid for the SIRK they were
+ * resolved with, so the entries are flushed when a different SIRK is used.
+ */
+#define RSI_CACHE_SIZE 8
+
+struct rsi_cache_entry {
+	bt_addr_le_t addr;
+	uint8_t rsi[CSIP_RSI_SIZE];
+	bool is_member;
+	bool valid;
+};
+
+static struct rsi_cache {
+	struct rsi_cache_entry entries[RSI_CACHE_SIZE];
+	uint8_t sirk[CSIP_SIRK_SIZE]; // SIRK the entries were resolved with
+	uint8_t next; // Next entry to replace
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t aes_calls;
+} rsi_cache;
+
+static void rsi_cache_flush(const uint8_t *sirk)
+{
+	memset(rsi_cache.entries, 0, sizeof(rsi_cache.entries));
+	memcpy(rsi_cache.sirk, sirk, CSIP_SIRK_SIZE);
+	rsi_cache.next = 0;
+}
+
+static void rsi_cache_print_stats(void)
+{
+	LOG_INF("RSI cache: %u hits, %u misses, %u AES resolutions", rsi_cache.hits,
+		rsi_cache.misses, rsi_cache.aes_calls);
+}
+
+/**
+ * @brief Check whether an RSI belongs to the set of @p device_id, using the cache if possible
+ *
+ * @param device_id Device ID whose SIRK is used
+ * @param addr Advertiser address
+ * @param rsi RSI bytes (CSIP_RSI_SIZE)
+ * @return true if the RSI resolves with the SIRK, false otherwise
+ */
+static bool rsi_is_set_member(uint8_t device_id, const bt_addr_le_t *addr, const uint8_t *rsi)
+{
+	const uint8_t *sirk = csip_ctx[device_id].sirk;
+
+	if (memcmp(rsi_cache.sirk, sirk, CSIP_SIRK_SIZE) != 0) {
+		rsi_cache_flush(sirk);
+	}
+
+	for (uint8_t i = 0; i < RSI_CACHE_SIZE; i++) {
+		struct rsi_cache_entry *entry = &rsi_cache.entries[i];
+
+		if (entry->valid && bt_addr_le_eq(&entry->addr, addr) &&
+		    memcmp(entry->rsi, rsi, CSIP_RSI_SIZE) == 0) {
+			rsi_cache.hits++;
+			return entry->is_member;
+		}
+	}
+
+	rsi_cache.misses++;
+
+	struct bt_data data = {
+		.type = BT_DATA_CSIS_RSI,
+		.data_len = CSIP_RSI_SIZE,
+		.data = rsi,
+	};
+
+	rsi_cache.aes_calls++;
+	bool is_member = bt_csip_set_coordinator_is_set_member(sirk, &data);
+
+	struct rsi_cache_entry *entry = &rsi_cache.entries[rsi_cache.next];
+	bt_addr_le_copy(&entry->addr, addr);
+	memcpy(entry->rsi, rsi, CSIP_RSI_SIZE);
+	entry->is_member = is_member;
+	entry->valid = true;
+	rsi_cache.next = (rsi_cache.next + 1) % RSI_CACHE_SIZE;
+
+	return is_member;
+}
+
 int csip_cmd_discover(uint8_t device_id)
 {
     struct device_context *ctx = &device_ctx[device_id];
+
+    if (!ctx->conn) {
+        return -ENOTCONN;
+    }
+
+    /* Keyed by the identity address, as the SIRK is, not the address the ear was scanned with */
+    const bt_addr_le_t *addr = bt_conn_get_dst(ctx->conn);
+
+    /* Reset cache flag - will be set if handles are successfully loaded from cache */
+    handles_from_cache[device_id] = false;
+
+    /* Try to load cached handles first */
+    struct bt_csip_set_coordinator_handles cached_handles;
+    int load_err = csip_settings_load_handles(addr, &cached_handles);
+    if (load_err == 0) {
+        LOG_INF("Loaded cached CSIS handles [DEVICE ID %d]", device_id);
+        int inject_err = bt_csip_set_coordinator_set_handles(ctx->conn, &cached_handles);
+        if (inject_err == -EBUSY) {
+            /* The other ear's CSIP procedure is running, the cached handles are still fine */
+            LOG_WRN("CSIP busy, cached CSIS handles kept [DEVICE ID %d]", device_id);
+            return inject_err;
+        } else if (inject_err != 0) {
+            LOG_WRN("Failed to inject cached CSIS handles (err %d), proceeding with full discovery",
+                    inject_err);
+            if (inject_err == -EINVAL) {
+                /* Only a rejected record is dropped, the value reads catch stale handles */
+                csip_settings_clear_handles(addr);
+            }
+        } else {
+            handles_from_cache[device_id] = true;
+        }
+    }
+
     return bt_csip_set_coordinator_discover(ctx->conn);
 }
 
@@ -44,6 +169,11 @@ static void csip_discover_cb(struct bt_conn *conn, const struct bt_csip_set_coor
 
     if (err) {
         LOG_ERR("CSIP Coordinator discovery failed (err %d) [DEVICE ID %d]", err, dev_ctx->device_id);
+        if (handles_from_cache[dev_ctx->device_id]) {
+            /* Cached handles no longer match the device, discover in full next time */
+            csip_settings_clear_handles(bt_conn_get_dst(conn));
+            handles_from_cache[dev_ctx->device_id] = false;
+        }
         ble_cmd_complete(dev_ctx->device_id, err);
         return;
     }
@@ -52,6 +182,14 @@ static void csip_discover_cb(struct bt_conn *conn, const struct bt_csip_set_coor
     LOG_INF("  Set count: %zu", set_count);
     dev_ctx->info.csip_discovered = true;
 
+    if (!handles_from_cache[dev_ctx->device_id]) {
+        /* Cache handles for future reconnections */
+        struct bt_csip_set_coordinator_handles handles;
+        if (bt_csip_set_coordinator_get_handles(conn, &handles) == 0) {
+            csip_settings_store_handles(bt_conn_get_dst(conn), &handles);
+        }
+    }
+
     if (set_count == 0 || !members) {
         LOG_WRN("No set members discovered [DEVICE ID %d]", dev_ctx->device_id);
         ble_cmd_complete(dev_ctx->device_id, -ENODATA);
@@ -214,228 +352,129 @@ bool csip_verify_devices_are_set()
     return match;
 }
 
-/**
- * @brief Store SIRK and rank for a bonded device
- *
- * @param addr Bluetooth address of the device
- * @param sirk SIRK value (16 bytes)
- * @param rank Device rank in the set (1 = left, 2 = right)
- * @return 0 on success, negative error code on failure
- */
-int csip_settings_store_sirk(const bt_addr_le_t *addr, const uint8_t *sirk, uint8_t rank)
+static bool rsi_scan_adv_parse(struct bt_data *data, void *user_data)
 {
-	if (!addr || !sirk) {
-		return -EINVAL;
-	}
-
-	char addr_str[BT_ADDR_LE_STR_LEN];
-	bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
-
-	// Create settings key for SIRK: "harc/device/<addr>/sirk"
-	char key_sirk[64];
-	snprintk(key_sirk, sizeof(key_sirk), "harc/device/%s/sirk", addr_str);
-
-	// Create settings key for rank: "harc/device/<addr>/rank"
-	char key_rank[64];
-	snprintk(key_rank, sizeof(key_rank), "harc/device/%s/rank", addr_str);
+	struct scan_callback_data *info = (struct scan_callback_data *)user_data;
 
-	int err;
+	if (data->type == BT_DATA_CSIS_RSI) {
+		if (data->data_len != CSIP_RSI_SIZE) {
+			return true;
+		}
 
-	// Store SIRK
-	err = settings_save_one(key_sirk, sirk, CSIP_SIRK_SIZE);
-	if (err) {
-		LOG_ERR("Failed to store SIRK for %s (err %d)", addr_str, err);
-		return err;
-	}
+		/* Skip devices that are already known */
+		if (devices_manager_get_device_context_by_addr(&info->addr) ||
+		    devices_manager_find_bonded_entry_by_addr(&info->addr, NULL)) {
+			return false;  // Stop parsing
+		}
 
-	// Store rank
-	err = settings_save_one(key_rank, &rank, sizeof(rank));
-	if (err) {
-		LOG_ERR("Failed to store rank for %s (err %d)", addr_str, err);
-		return err;
+		if (rsi_is_set_member(rsi_scan_context.device_id, &info->addr, data->data)) {
+			rsi_scan_context.rsi_found = true;
+			return false;  // Stop parsing
+		}
 	}
 
-	LOG_INF("Stored CSIP info for %s: rank=%d", addr_str, rank);
-	return 0;
+	return true;
 }
 
-/* Context for settings load callback */
-struct csip_load_context {
-	uint8_t *sirk;
-	uint8_t *rank;
-	bool sirk_found;
-	bool rank_found;
-};
-
-/* Settings load callback for CSIP data */
-static int csip_settings_load_cb(const char *key, size_t len, settings_read_cb read_cb,
-                                   void *cb_arg, void *param)
+void rsi_scan_cb(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
+							struct net_buf_simple *ad)
 {
-	struct csip_load_context *ctx = (struct csip_load_context *)param;
-	const char *name;
-
-	if (!key) {
-		return 0;
-	}
+	struct scan_callback_data info = {0};
+	info.addr = *addr;
+	info.rssi = rssi;
 
-	// Extract the leaf name from the key (after last '/')
-	name = strrchr(key, '/');
-	if (name) {
-		name++; // Skip the '/'
-	} else {
-		name = key;
-	}
+	bt_data_parse(ad, rsi_scan_adv_parse, &info);
 
-	if (strcmp(name, "sirk") == 0) {
-		if (len == CSIP_SIRK_SIZE) {
-			read_cb(cb_arg, ctx->sirk, CSIP_SIRK_SIZE);
-			ctx->sirk_found = true;
-		}
-	} else if (strcmp(name, "rank") == 0) {
-		if (len == sizeof(uint8_t)) {
-			read_cb(cb_arg, ctx->rank, sizeof(uint8_t));
-			ctx->rank_found = true;
-		}
+	// If RSI matched, stop scanning and connect to the device
+	if (rsi_scan_context.rsi_found) {
+		char addr_str[BT_ADDR_LE_STR_LEN];
+		bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
+		LOG_INF("RSI from %s matches SIRK", addr_str);
+		// LOG_INF("Stopping RSI scan");
+		uint8_t device_id = rsi_scan_context.device_id;
+		bt_addr_le_copy(&rsi_scan_context.match_addr, addr);
+		rsi_scan_stop();
+		app_controller_notify_csip_member_match(device_id, 0, &rsi_scan_context.match_addr);
 	}
-
-	return 0;
 }
 
 /**
- * @brief Load SIRK and rank for a bonded device
+ * @brief Check if an address is an RPA of an HI we are connected to
  *
- * @param addr Bluetooth address of the device
- * @param sirk Buffer to store SIRK (must be 16 bytes)
- * @param rank Pointer to store rank value
- * @return 0 on success, negative error code on failure
+ * The first scan also sees the connected ear, under an RPA that is neither the address it
+ * was connected with nor its identity address. That RPA resolves with the IRK the ear
+ * distributed when pairing.
  */
-int csip_settings_load_sirk(const bt_addr_le_t *addr, uint8_t *sirk, uint8_t *rank)
+static bool rsi_addr_is_connected_ear(const bt_addr_le_t *addr)
 {
-	if (!addr || !sirk || !rank) {
-		return -EINVAL;
+	if (!bt_addr_le_is_rpa(addr)) {
+		return false;
 	}
 
-	char addr_str[BT_ADDR_LE_STR_LEN];
-	bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
-
-	// Create settings key base for this device
-	char key_base[64];
-	snprintk(key_base, sizeof(key_base), "harc/device/%s", addr_str);
-
-	// Set up context for callback
-	struct csip_load_context ctx = {
-		.sirk = sirk,
-		.rank = rank,
-		.sirk_found = false,
-		.rank_found = false,
-	};
+	for (uint8_t i = 0; i < 2; i++) {
+		if (!device_ctx[i].conn) {
+			continue;
+		}
 
-	// Load settings for this device
-	int err = settings_load_subtree_direct(key_base, csip_settings_load_cb, &ctx);
-	if (err) {
-		LOG_DBG("Failed to load settings for %s (err %d)", addr_str, err);
-		return -ENOENT;
-	}
+		struct bt_keys *keys = bt_keys_find_addr(BT_ID_DEFAULT,
+							 bt_conn_get_dst(device_ctx[i].conn));
 
-	if (!ctx.sirk_found || !ctx.rank_found) {
-		LOG_DBG("CSIP data not found for %s (SIRK: %s, rank: %s)",
-		        addr_str,
-		        ctx.sirk_found ? "yes" : "no",
-		        ctx.rank_found ? "yes" : "no");
-		return -ENOENT;
+		if (keys && (keys->keys & BT_KEYS_IRK) &&
+		    bt_rpa_irk_matches(keys->irk.val, &addr->a)) {
+			return true;
+		}
 	}
 
-	LOG_DBG("Loaded CSIP info for %s: rank=%d", addr_str, *rank);
-	return 0;
+	return false;
 }
 
 /**
- * @brief Clear CSIP settings for a device
+ * @brief Look for the other set member among the HIs seen during the first scan
+ *
+ * The RSIs captured while scanning for HIs are resolved against the SIRK of
+ * @p device_id. On a match the state machine is notified right away, so the
+ * second ear can be connected without a dedicated RSI scan.
  *
- * @param addr Bluetooth address of the device
- * @return 0 on success, negative error code on failure
+ * @param device_id Device ID whose SIRK is used
+ * @return 0 if a set member was found, -ENOENT if not, other negative error code on failure
  */
-int csip_settings_clear_device(const bt_addr_le_t *addr)
+int csip_coordinator_match_scanned_devices(uint8_t device_id)
 {
-	if (!addr) {
+	if (device_id > 1 || !csip_ctx[device_id].sirk_discovered) {
 		return -EINVAL;
 	}
 
-	char addr_str[BT_ADDR_LE_STR_LEN];
-	bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
-
-	// Create settings keys
-	char key_sirk[64];
-	char key_rank[64];
-	snprintk(key_sirk, sizeof(key_sirk), "harc/device/%s/sirk", addr_str);
-	snprintk(key_rank, sizeof(key_rank), "harc/device/%s/rank", addr_str);
-
-	// Delete settings
-	int err1 = settings_delete(key_sirk);
-	int err2 = settings_delete(key_rank);
-
-	if (err1 || err2) {
-		LOG_WRN("Failed to clear settings for %s (SIRK: %d, rank: %d)",
-		        addr_str, err1, err2);
-	} else {
-		LOG_INF("Cleared CSIP settings for %s", addr_str);
-	}
+	uint8_t count = devices_manager_get_scanned_rsi_count();
+	struct scanned_rsi_entry entry;
 
-	return (err1 || err2) ? -EIO : 0;
-}
-
-static bool rsi_scan_adv_parse(struct bt_data *data, void *user_data)
-{
-	struct scan_callback_data *info = (struct scan_callback_data *)user_data;
-	char addr_str[BT_ADDR_LE_STR_LEN];
-	bt_addr_le_to_str(&info->addr, addr_str, sizeof(addr_str));
-
-	if (data->type == BT_DATA_CSIS_RSI) {
-		LOG_DBG("RSI data received from %s, RSSI %d dBm", addr_str, info->rssi);
-		LOG_DBG("Checking if device is already known; skipping if so...");
-		struct device_context *ctx = devices_manager_get_device_context_by_addr(&info->addr);
-		if (ctx) {
-			LOG_DBG("... skipping that mf");
-			return false;  // Stop parsing
-		} else {
-			if (devices_manager_find_bonded_entry_by_addr(&info->addr, NULL)) {
-				LOG_DBG("... skipping that mf (bonded device)");
-				return false;  // Stop parsing
-			}
+	for (uint8_t i = 0; i < count; i++) {
+		if (devices_manager_get_scanned_rsi(i, &entry) != 0) {
+			continue;
 		}
 
-		LOG_HEXDUMP_DBG(data->data, data->data_len, "RSI data:");
-		LOG_HEXDUMP_DBG(csip_ctx[rsi_scan_context.device_id].sirk, CSIP_SIRK_SIZE, "Using SIRK:");
-		
-		if (bt_csip_set_coordinator_is_set_member(csip_ctx[rsi_scan_context.device_id].sirk, data)) {
-			rsi_scan_context.rsi_found = true;
-			return false;  // Stop parsing
-		} else {
-			LOG_DBG("RSI does not match SIRK for %s", addr_str);
+		/* Skip the ear we are already connected to, and devices that are already known */
+		if (devices_manager_get_device_context_by_addr(&entry.addr) ||
+		    devices_manager_find_bonded_entry_by_addr(&entry.addr, NULL) ||
+		    rsi_addr_is_connected_ear(&entry.addr)) {
+			continue;
 		}
-	}
 
-	return true;
-}
+		if (rsi_is_set_member(device_id, &entry.addr, entry.rsi)) {
+			char addr_str[BT_ADDR_LE_STR_LEN];
+			bt_addr_le_to_str(&entry.addr, addr_str, sizeof(addr_str));
+			LOG_INF("RSI from %s (first scan) matches SIRK [DEVICE ID %d]", addr_str,
+				device_id);
 
-void rsi_scan_cb(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
-							struct net_buf_simple *ad)
-{
-	struct scan_callback_data info = {0};
-	info.addr = *addr;
-	info.rssi = rssi;
-
-	bt_data_parse(ad, rsi_scan_adv_parse, &info);
-
-	// If RSI matched, stop scanning and connect to the device
-	if (rsi_scan_context.rsi_found) {
-		char addr_str[BT_ADDR_LE_STR_LEN];
-		bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
-		LOG_INF("RSI from %s matches SIRK", addr_str);
-		// LOG_INF("Stopping RSI scan");
-		rsi_scan_stop();
-		app_controller_notify_csip_member_match(rsi_scan_context.device_id, 0, addr);
+			bt_addr_le_copy(&rsi_scan_context.match_addr, &entry.addr);
+			app_controller_notify_csip_member_match(device_id, 0,
+								&rsi_scan_context.match_addr);
+			return 0;
+		}
 	}
+
+	LOG_INF("No set member among %d RSI(s) from the first scan [DEVICE ID %d]", count,
+		device_id);
+	return -ENOENT;
 }
 
 void csip_coordinator_rsi_scan_start(uint8_t device_id) {
@@ -473,6 +512,7 @@ static void rsi_scan_stop() {
 	}
 
 	LOG_INF("RSI scanning stopped");
+	rsi_cache_print_stats();
 
 	rsi_scan_context.active = false;
 	rsi_scan_context.device_id = 0;
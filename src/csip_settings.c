@@ -0,0 +1,166 @@
+/**
+ * @file csip_settings.c
+ * @brief CSIP set membership and handle caching in the GATT cache record
+ */
+
+#include "csip_settings.h"
+#include "gatt_cache.h"
+
+#include <zephyr/logging/log.h>
+#include <string.h>
+
+LOG_MODULE_REGISTER(csip_settings, LOG_LEVEL_INF);
+
+/**
+ * @brief Store CSIS handles to NVS
+ */
+int csip_settings_store_handles(const bt_addr_le_t *addr,
+                                const struct bt_csip_set_coordinator_handles *handles)
+{
+	if (!addr || !handles) {
+		return -EINVAL;
+	}
+
+	char addr_str[BT_ADDR_LE_STR_LEN];
+	bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
+
+	/* Store handles in the device's GATT cache record */
+	int err = gatt_cache_update(addr, GATT_CACHE_CSIS, handles, sizeof(*handles));
+	if (err) {
+		LOG_ERR("Failed to store CSIS handles for %s (err %d)", addr_str, err);
+		return err;
+	}
+
+	LOG_INF("Stored CSIS handles for %s (%u instance%s)", addr_str, handles->inst_count,
+	        handles->inst_count == 1 ? "" : "s");
+	for (uint8_t i = 0; i < handles->inst_count; i++) {
+		const struct bt_csip_set_coordinator_inst_handles *inst = &handles->insts[i];
+
+		LOG_INF("  [%u] service: 0x%04x-0x%04x, sirk: %u (ccc: %u), rank: %u", i,
+		        inst->start_handle, inst->end_handle, inst->sirk_handle,
+		        inst->sirk_ccc_handle, inst->rank_handle);
+	}
+	return 0;
+}
+
+/**
+ * @brief Load CSIS handles from NVS
+ */
+int csip_settings_load_handles(const bt_addr_le_t *addr,
+                               struct bt_csip_set_coordinator_handles *handles)
+{
+	if (!addr || !handles) {
+		return -EINVAL;
+	}
+
+	char addr_str[BT_ADDR_LE_STR_LEN];
+	bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
+
+	int err = gatt_cache_lookup(addr, GATT_CACHE_CSIS, handles, sizeof(*handles));
+	if (err) {
+		LOG_DBG("CSIS handles not found for %s", addr_str);
+		return err;
+	}
+
+	LOG_INF("Loaded CSIS handles for %s (%u instance%s)", addr_str, handles->inst_count,
+	        handles->inst_count == 1 ? "" : "s");
+	return 0;
+}
+
+/**
+ * @brief Clear CSIS handles from NVS
+ */
+int csip_settings_clear_handles(const bt_addr_le_t *addr)
+{
+	if (!addr) {
+		return -EINVAL;
+	}
+
+	char addr_str[BT_ADDR_LE_STR_LEN];
+	bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
+
+	int err = gatt_cache_invalidate(addr, BIT(GATT_CACHE_CSIS));
+	if (err) {
+		LOG_ERR("Failed to clear CSIS handles for %s (err %d)", addr_str, err);
+		return err;
+	}
+
+	LOG_INF("Cleared CSIS handles for %s", addr_str);
+	return 0;
+}
+
+/**
+ * @brief Store SIRK and rank for a bonded device
+ */
+int csip_settings_store_sirk(const bt_addr_le_t *addr, const uint8_t *sirk, uint8_t rank)
+{
+	if (!addr || !sirk) {
+		return -EINVAL;
+	}
+
+	char addr_str[BT_ADDR_LE_STR_LEN];
+	bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
+
+	struct gatt_cache_csip csip = {
+		.rank = rank,
+	};
+	memcpy(csip.sirk, sirk, GATT_CACHE_SIRK_SIZE);
+
+	/* Store SIRK and rank with the GATT cache, under their own key */
+	int err = gatt_cache_update(addr, GATT_CACHE_CSIP, &csip, sizeof(csip));
+	if (err) {
+		LOG_ERR("Failed to store CSIP info for %s (err %d)", addr_str, err);
+		return err;
+	}
+
+	LOG_INF("Stored CSIP info for %s: rank=%d", addr_str, rank);
+	return 0;
+}
+
+/**
+ * @brief Load SIRK and rank for a bonded device
+ */
+int csip_settings_load_sirk(const bt_addr_le_t *addr, uint8_t *sirk, uint8_t *rank)
+{
+	if (!addr || !sirk || !rank) {
+		return -EINVAL;
+	}
+
+	char addr_str[BT_ADDR_LE_STR_LEN];
+	bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
+
+	struct gatt_cache_csip csip;
+	int err = gatt_cache_lookup(addr, GATT_CACHE_CSIP, &csip, sizeof(csip));
+	if (err) {
+		LOG_DBG("CSIP data not found for %s", addr_str);
+		return err;
+	}
+
+	memcpy(sirk, csip.sirk, GATT_CACHE_SIRK_SIZE);
+	*rank = csip.rank;
+
+	LOG_DBG("Loaded CSIP info for %s: rank=%d", addr_str, *rank);
+	return 0;
+}
+
+/**
+ * @brief Clear SIRK and rank for a device
+ */
+int csip_settings_clear_device(const bt_addr_le_t *addr)
+{
+	if (!addr) {
+		return -EINVAL;
+	}
+
+	char addr_str[BT_ADDR_LE_STR_LEN];
+	bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
+
+	int err = gatt_cache_invalidate(addr, BIT(GATT_CACHE_CSIP));
+	if (err) {
+		LOG_WRN("Failed to clear CSIP settings for %s (err %d)", addr_str, err);
+		return err;
+	}
+
+	LOG_INF("Cleared CSIP settings for %s", addr_str);
+	return 0;
+}
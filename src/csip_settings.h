@@ -0,0 +1,69 @@
+/**
+ * @file csip_settings.h
+ * @brief CSIP set membership and handle caching in the GATT cache record
+ */
+
+#ifndef CSIP_SETTINGS_H_
+#define CSIP_SETTINGS_H_
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/audio/csip.h>
+#include <stdint.h>
+
+/**
+ * @brief Store CSIS handles to NVS
+ *
+ * @param addr Bluetooth address of the device
+ * @param handles CSIS handles structure to store
+ * @return 0 on success, negative errno on failure
+ */
+int csip_settings_store_handles(const bt_addr_le_t *addr,
+                                const struct bt_csip_set_coordinator_handles *handles);
+
+/**
+ * @brief Load CSIS handles from NVS
+ *
+ * @param addr Bluetooth address of the device
+ * @param handles Buffer to store loaded handles
+ * @return 0 on success, -ENOENT if not found, negative errno on failure
+ */
+int csip_settings_load_handles(const bt_addr_le_t *addr,
+                               struct bt_csip_set_coordinator_handles *handles);
+
+/**
+ * @brief Clear CSIS handles from NVS
+ *
+ * @param addr Bluetooth address of the device
+ * @return 0 on success, negative errno on failure
+ */
+int csip_settings_clear_handles(const bt_addr_le_t *addr);
+
+/**
+ * @brief Store SIRK and rank for a bonded device
+ *
+ * @param addr Bluetooth address of the device
+ * @param sirk SIRK value (16 bytes)
+ * @param rank Device rank in the set (1 = left, 2 = right)
+ * @return 0 on success, negative errno on failure
+ */
+int csip_settings_store_sirk(const bt_addr_le_t *addr, const uint8_t *sirk, uint8_t rank);
+
+/**
+ * @brief Load SIRK and rank for a bonded device
+ *
+ * @param addr Bluetooth address of the device
+ * @param sirk Buffer to store SIRK (must be 16 bytes)
+ * @param rank Pointer to store rank value
+ * @return 0 on success, -ENOENT if not found, negative errno on failure
+ */
+int csip_settings_load_sirk(const bt_addr_le_t *addr, uint8_t *sirk, uint8_t *rank);
+
+/**
+ * @brief Clear SIRK and rank for a device
+ *
+ * @param addr Bluetooth address of the device
+ * @return 0 on success, negative errno on failure
+ */
+int csip_settings_clear_device(const bt_addr_le_t *addr);
+
+#endif /* CSIP_SETTINGS_H_ */
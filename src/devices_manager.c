@@ -3,15 +3,18 @@
 #include "app_controller.h"
 #include "csip_coordinator.h"
 #include "display_manager.h"
-#include "has_settings.h"
-#include "vcp_settings.h"
-#include "bas_settings.h"
+#include "gatt_cache.h"
+#include "retained_state.h"
 
 LOG_MODULE_REGISTER(devices_manager, LOG_LEVEL_INF);
 
 struct device_context *device_ctx;
 struct bond_collection *bonded_devices;
 
+/* Bond table kept through System OFF, rebuilt from the stack's bonds otherwise */
+static __noinit struct bond_collection retained_bonds;
+static __noinit struct retained_seal bonds_seal;
+
 int devices_manager_get_bonded_devices_collection(struct bond_collection *collection)
 {
 	memcpy(collection, bonded_devices, sizeof(struct bond_collection));
@@ -27,16 +30,16 @@ int devices_manager_get_bonded_devices_collection(struct bond_collection *collec
 /**
  * @brief Check if an address is in the bonded devices collection
  * @param addr Pointer to the address
- * @param out_entry Pointer to store the found bonded device entry, or NULL if not found
+ * @param out_entry Pointer to store the found bonded device entry, can be NULL
  * @return bool
- * @note out_entry must be allocated by the caller; if the device is not found, it will be set to
- * NULL
  */
 bool devices_manager_find_bonded_entry_by_addr(const bt_addr_le_t *addr, struct bonded_device_entry *out_entry)
 {
   for (uint8_t i = 0; i < bonded_devices->count; i++) {
 		if (bt_addr_le_cmp(addr, &bonded_devices->devices[i].addr) == 0) {
-			memcpy(out_entry, &bonded_devices->devices[i], sizeof(*out_entry));
+			if (out_entry) {
+				memcpy(out_entry, &bonded_devices->devices[i], sizeof(*out_entry));
+			}
 			return true;
 		}
   }
@@ -142,33 +145,12 @@ void devices_manager_clear_all_bonds(void)
 	LOG_WRN("Clearing all bonds...");
 
 	for (ssize_t i = 0; i < bonded_devices->count; i++) {
-		// Erase handles from memory
-		int err = has_settings_clear_handles(&bonded_devices->devices[i].addr);
-		if (err != 0) {
-			LOG_ERR("Failed to clear HAS handles for device %d (err %d)", i, err);
-		} else {
-			LOG_DBG("Cleared HAS handles for device %d", i);
-		}
-
-		err = vcp_settings_clear_handles(&bonded_devices->devices[i].addr);
-		if (err != 0) {
-			LOG_ERR("Failed to clear VCP handles for device %d (err %d)", i, err);
-		} else {
-			LOG_DBG("Cleared VCP handles for device %d", i);
-		}
-
-		err = csip_settings_clear_device(&bonded_devices->devices[i].addr);
-		if (err != 0) {
-			LOG_ERR("Failed to clear CSIP device settings for device %d (err %d)", i, err);
-		} else {
-			LOG_DBG("Cleared CSIP device settings for device %d", i);
-		}
-
-		err = bas_settings_clear_handles(&bonded_devices->devices[i].addr);
+		// Erase cached handles, features and set membership in one go
+		int err = gatt_cache_delete(&bonded_devices->devices[i].addr);
 		if (err != 0) {
-			LOG_ERR("Failed to clear BAS handles for device %d (err %d)", i, err);
+			LOG_ERR("Failed to clear GATT cache for device %d (err %d)", i, err);
 		} else {
-			LOG_DBG("Cleared BAS handles for device %d", i);
+			LOG_DBG("Cleared GATT cache for device %d", i);
 		}
 
 		err = bt_unpair(BT_ID_DEFAULT, &bonded_devices->devices[i].addr);
@@ -179,10 +161,14 @@ void devices_manager_clear_all_bonds(void)
 		}
 	}
 
+	/* The last known state belonged to the old set */
+	display_manager_delete_snapshot();
+
 	settings_save();
 
 	// Erase bonds from RAM
 	memset(bonded_devices, 0, sizeof(struct bond_collection));
+	ble_manager_load_accept_list();
 
 	LOG_INF("All bonds cleared");
 	app_controller_notify_bonds_cleared();
@@ -252,15 +238,15 @@ int devices_manager_init(void)
 	
 	devices_manager_reset_device_contexts();
 
-	bonded_devices = (struct bond_collection *)k_calloc(1, sizeof(struct bond_collection));
-	if (!bonded_devices) {
-		LOG_ERR("Failed to allocate memory for bonded devices");
-		k_free(device_ctx);
-		return -ENOMEM;
+	bonded_devices = &retained_bonds;
+	if (retained_state_restore("Bond table", &bonds_seal, bonded_devices,
+				   sizeof(*bonded_devices))) {
+		LOG_INF("Bonded devices collection retained. Total bonded devices: %d",
+			bonded_devices->count);
+	} else {
+		devices_manager_update_bonded_devices_collection();
 	}
 
-	devices_manager_update_bonded_devices_collection();
-
 	LOG_INF("Devices manager initialized");
 	return 0;
 }
@@ -290,18 +276,50 @@ struct device_context *devices_manager_get_device_context_by_id(uint8_t device_i
 	return &device_ctx[device_id];
 }
 
-/* Scanned devices list management */
-static sys_slist_t scanned_devices_list;
-static struct k_mutex scanned_list_mutex;
+/**
+ * Scanned devices table. Entries are kept in the order they were first seen and are
+ * never moved, so pointers handed out stay valid until the table is cleared.
+ * The entry with the strongest smoothed RSSI is tracked on every update.
+ */
+static struct scanned_device_entry scanned_devices[MAX_SCANNED_DEVICES];
 static uint8_t scanned_device_count = 0;
-static bool scanned_list_initialized = false;
+static int8_t best_scanned_idx = -1;
+static struct k_spinlock scanned_lock;
+
+/* RSIs seen during the HI scan, also protected by scanned_lock */
+static struct scanned_rsi_entry scanned_rsis[MAX_SCANNED_RSIS];
+static uint8_t scanned_rsi_count;
+static uint8_t next_scanned_rsi;
 
-static void init_scanned_list(void)
+static struct scanned_device_entry *find_scanned_device(const bt_addr_le_t *addr)
 {
-	if (!scanned_list_initialized) {
-		sys_slist_init(&scanned_devices_list);
-		k_mutex_init(&scanned_list_mutex);
-		scanned_list_initialized = true;
+	for (uint8_t i = 0; i < scanned_device_count; i++) {
+		if (bt_addr_le_eq(&scanned_devices[i].addr, addr)) {
+			return &scanned_devices[i];
+		}
+	}
+
+	return NULL;
+}
+
+/* Must be called with scanned_lock held */
+static void update_best_scanned_device(uint8_t idx)
+{
+	if (best_scanned_idx < 0 ||
+	    scanned_devices[idx].rssi_avg > scanned_devices[best_scanned_idx].rssi_avg) {
+		best_scanned_idx = idx;
+		return;
+	}
+
+	if (idx != best_scanned_idx) {
+		return;
+	}
+
+	/* The best entry got weaker, another one may have overtaken it */
+	for (uint8_t i = 0; i < scanned_device_count; i++) {
+		if (scanned_devices[i].rssi_avg > scanned_devices[best_scanned_idx].rssi_avg) {
+			best_scanned_idx = i;
+		}
 	}
 }
 
@@ -311,116 +329,52 @@ int devices_manager_add_scanned_device(const bt_addr_le_t *addr, int8_t rssi)
 		return -EINVAL;
 	}
 
-	init_scanned_list();
-
-	k_mutex_lock(&scanned_list_mutex, K_FOREVER);
+	k_spinlock_key_t key = k_spin_lock(&scanned_lock);
 
 	// Check if address already exists
-	sys_snode_t *node;
-	sys_snode_t *prev_node = NULL;
-	SYS_SLIST_FOR_EACH_NODE(&scanned_devices_list, node) {
-		struct scanned_device_entry *entry = CONTAINER_OF(node, struct scanned_device_entry, node);
-		if (bt_addr_le_cmp(&entry->addr, addr) == 0) {
-			// Address already in list, update RSSI and re-sort if needed
-			if (entry->rssi != rssi) {
-				entry->rssi = rssi;
-
-				// Remove from current position
-				if (prev_node == NULL) {
-					sys_slist_get(&scanned_devices_list);
-				} else {
-					sys_slist_remove(&scanned_devices_list, prev_node, node);
-				}
-
-				// Re-insert in sorted order
-				sys_snode_t *insert_prev = NULL;
-				sys_snode_t *insert_curr;
-				bool inserted = false;
-
-				SYS_SLIST_FOR_EACH_NODE(&scanned_devices_list, insert_curr) {
-					struct scanned_device_entry *curr_entry = CONTAINER_OF(insert_curr, struct scanned_device_entry, node);
-					if (rssi > curr_entry->rssi) {
-						if (insert_prev == NULL) {
-							sys_slist_prepend(&scanned_devices_list, &entry->node);
-						} else {
-							sys_slist_insert(&scanned_devices_list, insert_prev, &entry->node);
-						}
-						inserted = true;
-						break;
-					}
-					insert_prev = insert_curr;
-				}
-
-				if (!inserted) {
-					sys_slist_append(&scanned_devices_list, &entry->node);
-				}
-			}
-			k_mutex_unlock(&scanned_list_mutex);
-			return scanned_device_count;
+	struct scanned_device_entry *entry = find_scanned_device(addr);
+	if (entry) {
+		entry->rssi = rssi;
+		entry->rssi_avg += (rssi * SCAN_RSSI_AVG_SCALE - entry->rssi_avg) /
+				   (1 << SCAN_RSSI_EWMA_SHIFT);
+		if (entry->seen_count < UINT8_MAX) {
+			entry->seen_count++;
 		}
-		prev_node = node;
+		update_best_scanned_device(entry - scanned_devices);
+
+		uint8_t count = scanned_device_count;
+		k_spin_unlock(&scanned_lock, key);
+		return count;
 	}
 
 	// Check if we've reached max devices
 	if (scanned_device_count >= MAX_SCANNED_DEVICES) {
-		k_mutex_unlock(&scanned_list_mutex);
+		k_spin_unlock(&scanned_lock, key);
 		LOG_WRN("Scanned devices list full (max %d)", MAX_SCANNED_DEVICES);
 		return scanned_device_count;
 	}
 
 	// Add new device
-	struct scanned_device_entry *new_entry = k_malloc(sizeof(struct scanned_device_entry));
-	if (!new_entry) {
-		k_mutex_unlock(&scanned_list_mutex);
-		LOG_ERR("Failed to allocate memory for scanned device");
-		return -ENOMEM;
-	}
+	uint8_t idx = scanned_device_count++;
+	entry = &scanned_devices[idx];
+	memset(entry, 0, sizeof(struct scanned_device_entry));
+	bt_addr_le_copy(&entry->addr, addr);
+	entry->rssi = rssi;
+	entry->rssi_avg = rssi * SCAN_RSSI_AVG_SCALE;
+	entry->seen_count = 1;
+	update_best_scanned_device(idx);
 
-	memset(new_entry, 0, sizeof(struct scanned_device_entry));
-	bt_addr_le_copy(&new_entry->addr, addr);
-	new_entry->rssi = rssi;
-
-	// Insert device in sorted order by RSSI (highest first)
-	prev_node = NULL;
-	sys_snode_t *curr_node;
-	bool inserted = false;
-
-	SYS_SLIST_FOR_EACH_NODE(&scanned_devices_list, curr_node) {
-		struct scanned_device_entry *curr_entry = CONTAINER_OF(curr_node, struct scanned_device_entry, node);
-		if (rssi > curr_entry->rssi) {
-			// Insert before this node
-			if (prev_node == NULL) {
-				// Insert at head
-				sys_slist_prepend(&scanned_devices_list, &new_entry->node);
-			} else {
-				// Insert after prev_node
-				sys_slist_insert(&scanned_devices_list, prev_node, &new_entry->node);
-			}
-			inserted = true;
-			break;
-		}
-		prev_node = curr_node;
-	}
-
-	// If not inserted yet, append to the end (weakest RSSI)
-	if (!inserted) {
-		sys_slist_append(&scanned_devices_list, &new_entry->node);
-	}
-
-	scanned_device_count++;
+	uint8_t count = scanned_device_count;
+	k_spin_unlock(&scanned_lock, key);
 
 	char addr_str[BT_ADDR_LE_STR_LEN];
 	bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
-	LOG_INF("Added scanned device %d: %s (RSSI: %d)", scanned_device_count, addr_str, rssi);
-
-	uint8_t count = scanned_device_count;
-	k_mutex_unlock(&scanned_list_mutex);
+	LOG_INF("Added scanned device %d: %s (RSSI: %d)", count, addr_str, rssi);
 
 	// If we've reached max devices, notify app_controller
 	if (count >= MAX_SCANNED_DEVICES) {
 		LOG_INF("Max scanned devices reached, stopping scan");
-		ble_manager_stop_scan_for_HIs();
-		app_controller_notify_scan_complete();
+		ble_manager_complete_scan_for_HIs();
 	}
 
 	return count;
@@ -432,87 +386,124 @@ int devices_manager_update_scanned_device_name(const bt_addr_le_t *addr, const c
 		return -EINVAL;
 	}
 
-	init_scanned_list();
+	k_spinlock_key_t key = k_spin_lock(&scanned_lock);
+
+	struct scanned_device_entry *entry = find_scanned_device(addr);
+	if (!entry) {
+		k_spin_unlock(&scanned_lock, key);
+		return -ENOENT;
+	}
+
+	strncpy(entry->name, name, BT_NAME_MAX_LEN - 1);
+	entry->name[BT_NAME_MAX_LEN - 1] = '\0';
+	k_spin_unlock(&scanned_lock, key);
 
-	k_mutex_lock(&scanned_list_mutex, K_FOREVER);
+	return 0;
+}
 
-	// Find device by address
-	sys_snode_t *node;
-	SYS_SLIST_FOR_EACH_NODE(&scanned_devices_list, node) {
-		struct scanned_device_entry *entry = CONTAINER_OF(node, struct scanned_device_entry, node);
+int devices_manager_store_scanned_rsi(const bt_addr_le_t *addr, const uint8_t *rsi)
+{
+	if (!addr || !rsi) {
+		return -EINVAL;
+	}
 
-		if (bt_addr_le_cmp(&entry->addr, addr) == 0) {
-			strncpy(entry->name, name, BT_NAME_MAX_LEN - 1);
-			entry->name[BT_NAME_MAX_LEN - 1] = '\0';
+	k_spinlock_key_t key = k_spin_lock(&scanned_lock);
 
-			char addr_str[BT_ADDR_LE_STR_LEN];
-			bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
-			LOG_DBG("Updated name for %s: %s", addr_str, name);
+	struct scanned_rsi_entry *entry = NULL;
 
-			k_mutex_unlock(&scanned_list_mutex);
-			return 0;
+	for (uint8_t i = 0; i < scanned_rsi_count; i++) {
+		if (bt_addr_le_eq(&scanned_rsis[i].addr, addr)) {
+			entry = &scanned_rsis[i];
+			break;
 		}
 	}
 
-	k_mutex_unlock(&scanned_list_mutex);
-	return -ENOENT;
+	if (!entry) {
+		if (scanned_rsi_count < MAX_SCANNED_RSIS) {
+			entry = &scanned_rsis[scanned_rsi_count++];
+		} else {
+			entry = &scanned_rsis[next_scanned_rsi];
+			next_scanned_rsi = (next_scanned_rsi + 1) % MAX_SCANNED_RSIS;
+		}
+		bt_addr_le_copy(&entry->addr, addr);
+	}
+
+	memcpy(entry->rsi, rsi, CSIP_RSI_SIZE);
+	k_spin_unlock(&scanned_lock, key);
+
+	return 0;
 }
 
-uint8_t devices_manager_get_scanned_device_count(void)
+int devices_manager_get_scanned_rsi(uint8_t idx, struct scanned_rsi_entry *out)
 {
-	init_scanned_list();
+	int err = -ENOENT;
+	k_spinlock_key_t key = k_spin_lock(&scanned_lock);
 
-	k_mutex_lock(&scanned_list_mutex, K_FOREVER);
-	uint8_t count = scanned_device_count;
-	k_mutex_unlock(&scanned_list_mutex);
+	if (idx < scanned_rsi_count) {
+		memcpy(out, &scanned_rsis[idx], sizeof(*out));
+		err = 0;
+	}
 
-	return count;
+	k_spin_unlock(&scanned_lock, key);
+	return err;
+}
+
+uint8_t devices_manager_get_scanned_rsi_count(void)
+{
+	return scanned_rsi_count;
+}
+
+uint8_t devices_manager_get_scanned_device_count(void)
+{
+	return scanned_device_count;
 }
 
 struct scanned_device_entry *devices_manager_get_scanned_device(uint8_t idx)
 {
-	if (idx >= MAX_SCANNED_DEVICES) {
+	if (idx >= scanned_device_count) {
 		return NULL;
 	}
 
-	init_scanned_list();
+	return &scanned_devices[idx];
+}
 
-	k_mutex_lock(&scanned_list_mutex, K_FOREVER);
+int devices_manager_get_best_scanned_device_idx(void)
+{
+	int idx = best_scanned_idx;
 
-	if (idx >= scanned_device_count) {
-		k_mutex_unlock(&scanned_list_mutex);
-		return NULL;
-	}
+	return (idx < 0) ? -ENOENT : idx;
+}
+
+uint8_t devices_manager_get_stable_scanned_device_count(void)
+{
+	uint8_t stable = 0;
+
+	k_spinlock_key_t key = k_spin_lock(&scanned_lock);
 
-	sys_snode_t *node;
-	uint8_t i = 0;
-	SYS_SLIST_FOR_EACH_NODE(&scanned_devices_list, node) {
-		if (i == idx) {
-			struct scanned_device_entry *entry = CONTAINER_OF(node, struct scanned_device_entry, node);
-			k_mutex_unlock(&scanned_list_mutex);
-			return entry;
+	for (uint8_t i = 0; i < scanned_device_count; i++) {
+		if (scanned_devices[i].seen_count >= BT_SCAN_STABLE_SEEN_COUNT &&
+		    scanned_devices[i].rssi_avg >= BT_SCAN_STABLE_RSSI_DBM * SCAN_RSSI_AVG_SCALE) {
+			stable++;
 		}
-		i++;
 	}
 
-	k_mutex_unlock(&scanned_list_mutex);
-	return NULL;
+	k_spin_unlock(&scanned_lock, key);
+
+	return stable;
 }
 
 void devices_manager_clear_scanned_devices(void)
 {
-	init_scanned_list();
-
-	k_mutex_lock(&scanned_list_mutex, K_FOREVER);
-
-	sys_snode_t *node;
-	while ((node = sys_slist_get(&scanned_devices_list)) != NULL) {
-		struct scanned_device_entry *entry = CONTAINER_OF(node, struct scanned_device_entry, node);
-		k_free(entry);
-	}
+	k_spinlock_key_t key = k_spin_lock(&scanned_lock);
 
+	memset(scanned_devices, 0, sizeof(scanned_devices));
 	scanned_device_count = 0;
-	k_mutex_unlock(&scanned_list_mutex);
+	best_scanned_idx = -1;
+	memset(scanned_rsis, 0, sizeof(scanned_rsis));
+	scanned_rsi_count = 0;
+	next_scanned_rsi = 0;
+
+	k_spin_unlock(&scanned_lock, key);
 
 	LOG_INF("Scanned devices list cleared");
 }
@@ -546,24 +537,17 @@ int devices_manager_select_scanned_device(uint8_t idx, struct device_info *out_i
 }
 
 void devices_manager_print_scanned_devices() {
-	init_scanned_list();
-
-	k_mutex_lock(&scanned_list_mutex, K_FOREVER);
-
 	LOG_INF("Scanned Devices List (Total: %d):", scanned_device_count);
-	sys_snode_t *node;
-	uint8_t idx = 0;
-	SYS_SLIST_FOR_EACH_NODE(&scanned_devices_list, node) {
-		struct scanned_device_entry *entry = CONTAINER_OF(node, struct scanned_device_entry, node);
+
+	for (uint8_t idx = 0; idx < scanned_device_count; idx++) {
+		struct scanned_device_entry *entry = &scanned_devices[idx];
 		char addr_str[BT_ADDR_LE_STR_LEN];
 		bt_addr_le_to_str(&entry->addr, addr_str, sizeof(addr_str));
-		LOG_INF("  [%d] Name: %s | RSSI: %d | Address: %s", idx,
-			strlen(entry->name) > 0 ? entry->name : "<unknown>", entry->rssi, addr_str);
-
-		idx++;
+		LOG_INF("  [%d]%s Name: %s | RSSI: %d (avg %d, seen %d) | Address: %s", idx,
+			idx == best_scanned_idx ? "*" : "",
+			strlen(entry->name) > 0 ? entry->name : "<unknown>", entry->rssi,
+			entry->rssi_avg / SCAN_RSSI_AVG_SCALE, entry->seen_count, addr_str);
 	}
-
-	k_mutex_unlock(&scanned_list_mutex);
 }
 
 struct device_context *devices_manager_get_device_context_by_addr(const bt_addr_le_t *addr)
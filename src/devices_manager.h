@@ -25,13 +25,26 @@ struct bond_collection
 
 #define MAX_SCANNED_DEVICES 10
 
+/* Smoothed RSSI is kept in 1/16 dBm; each report moves it 1/4 of the way */
+#define SCAN_RSSI_AVG_SCALE 16
+#define SCAN_RSSI_EWMA_SHIFT 2
+
 struct scanned_device_entry
 {
     bt_addr_le_t addr;
     char name[BT_NAME_MAX_LEN];
-    int8_t rssi;
-    sys_snode_t node;
-    uint8_t rsi[6];
+    int8_t rssi; /* RSSI of the latest report */
+    int16_t rssi_avg; /* EWMA of the RSSI, in 1/SCAN_RSSI_AVG_SCALE dBm */
+    uint8_t seen_count; /* Number of reports with the HI service UUID */
+};
+
+#define MAX_SCANNED_RSIS 8
+
+/* RSI seen during the HI scan, from any address */
+struct scanned_rsi_entry
+{
+    bt_addr_le_t addr;
+    uint8_t rsi[CSIP_RSI_SIZE];
 };
 
 struct device_info
@@ -104,8 +117,46 @@ int devices_manager_add_scanned_device(const bt_addr_le_t *addr, int8_t rssi);
  * @return 0 on success, negative error code on failure
  */
 int devices_manager_update_scanned_device_name(const bt_addr_le_t *addr, const char *name);
+
+/**
+ * @brief Keep an RSI seen during the HI scan
+ *
+ * The other ear advertises its RSI from its RPA, which is not in the scanned devices
+ * table, so RSIs are kept by advertiser address in their own small table. The address
+ * keeps its latest RSI, and the oldest address is replaced when the table is full.
+ *
+ * @param addr Pointer to the advertiser address
+ * @param rsi Pointer to the RSI (CSIP_RSI_SIZE bytes)
+ * @return 0 on success, negative error code on failure
+ */
+int devices_manager_store_scanned_rsi(const bt_addr_le_t *addr, const uint8_t *rsi);
+
+/**
+ * @brief Copy an RSI kept by devices_manager_store_scanned_rsi()
+ * @param idx Index, below devices_manager_get_scanned_rsi_count()
+ * @param out Output entry
+ * @return 0 on success, -ENOENT if @p idx is out of range
+ */
+int devices_manager_get_scanned_rsi(uint8_t idx, struct scanned_rsi_entry *out);
+uint8_t devices_manager_get_scanned_rsi_count(void);
 uint8_t devices_manager_get_scanned_device_count(void);
 struct scanned_device_entry *devices_manager_get_scanned_device(uint8_t idx);
+
+/**
+ * @brief Get the index of the scanned device with the strongest smoothed RSSI
+ * @return Index on success, -ENOENT if no device has been scanned
+ */
+int devices_manager_get_best_scanned_device_idx(void);
+
+/**
+ * @brief Count the scanned devices that are stable candidates
+ *
+ * A candidate is stable once it was seen at least BT_SCAN_STABLE_SEEN_COUNT times
+ * with a smoothed RSSI of at least BT_SCAN_STABLE_RSSI_DBM.
+ *
+ * @return Number of stable candidates
+ */
+uint8_t devices_manager_get_stable_scanned_device_count(void);
 void devices_manager_clear_scanned_devices(void);
 int devices_manager_select_scanned_device(uint8_t idx, struct device_info *out_info);
 void devices_manager_print_scanned_devices(void);
@@ -1,7 +1,11 @@
 #include "display_manager.h"
 #include "devices_manager.h"
+#include "retained_state.h"
 #include <zephyr/display/cfb.h>
 #include <zephyr/drivers/display.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/crc.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -24,9 +28,45 @@ struct display_state {
     uint8_t active_preset;
     char preset_name[32];
     bool has_data;
+    uint8_t stale; /* DISPLAY_STALE_* bits of values restored from the snapshot */
+};
+
+#define DISPLAY_STALE_VOLUME  BIT(0)
+#define DISPLAY_STALE_BATTERY BIT(1)
+#define DISPLAY_STALE_PRESET  BIT(2)
+
+/* Last known state of one ear as kept across power off */
+struct display_snapshot_ear {
+    uint8_t volume;
+    uint8_t mute;
+    uint8_t battery_level;
+    uint8_t active_preset;
+    char preset_name[DISPLAY_SNAPSHOT_NAME_LEN];
+};
+
+/**
+ * @brief Snapshot as stored in NVS
+ *
+ * The CRC covers everything before it. Snapshots are always zeroed before they are filled
+ * in, so the padding is part of the CRC too.
+ */
+struct display_snapshot {
+    uint8_t version;
+    uint8_t ears; /* BIT(device_id) of the ears with data */
+    struct display_snapshot_ear ear[2];
+    uint32_t crc;
 };
 
 static struct display_state device_display_state[2] = {0};
+/* Snapshot as last loaded or saved, kept through System OFF */
+static __noinit struct display_snapshot loaded_snapshot;
+static __noinit struct retained_seal snapshot_seal;
+/* k_uptime_get() when the snapshot was shown, status messages are held back for a while */
+static int64_t snapshot_shown_at;
+
+static void trigger_update(void);
+static int display_snapshot_load_cb(const char *key, size_t len, settings_read_cb read_cb,
+                                    void *cb_arg, void *param);
 static struct k_mutex display_mutex;
 static bool display_initialized = false;
 static bool display_sleeping = false;
@@ -81,9 +121,181 @@ int display_manager_init(void)
 
     display_initialized = true;
 
-    /* Show initial splash screen */
-    display_manager_show_status("Resound");
+    /**
+     * The snapshot is read on its own rather than waiting for the settings pass, which
+     * only runs once Bluetooth is up. The pass then skips it.
+     */
+    if (!retained_state_restore("Display snapshot", &snapshot_seal, &loaded_snapshot,
+                                sizeof(loaded_snapshot))) {
+        err = settings_load_subtree_direct(DISPLAY_SNAPSHOT_KEY, display_snapshot_load_cb,
+                                           &loaded_snapshot);
+        if (err) {
+            LOG_WRN("Failed to load display snapshot (err %d)", err);
+        }
+    }
+
+    /* Show the last known state right away, the splash screen only without one */
+    if (display_manager_restore_snapshot() != 0) {
+        display_manager_show_status("Resound");
+    }
+
+    return 0;
+}
+
+static uint32_t display_snapshot_crc(const struct display_snapshot *snapshot)
+{
+    return crc32_ieee((const uint8_t *)snapshot, offsetof(struct display_snapshot, crc));
+}
+
+/* Settings load callback for the snapshot */
+static int display_snapshot_load_cb(const char *key, size_t len, settings_read_cb read_cb,
+                                    void *cb_arg, void *param)
+{
+    struct display_snapshot *snapshot = (struct display_snapshot *)param;
+
+    if (key) {
+        return 0;
+    }
+
+    if (len != sizeof(*snapshot)) {
+        LOG_WRN("Invalid display snapshot size: %zu (expected %zu)", len, sizeof(*snapshot));
+        return 0;
+    }
+
+    if (read_cb(cb_arg, snapshot, sizeof(*snapshot)) != sizeof(*snapshot) ||
+        snapshot->version != DISPLAY_SNAPSHOT_VERSION ||
+        snapshot->crc != display_snapshot_crc(snapshot)) {
+        LOG_WRN("Discarding invalid display snapshot");
+        memset(snapshot, 0, sizeof(*snapshot));
+    }
+
+    return 0;
+}
+
+/* Settings handler for "harc/snapshot", already read by display_manager_init() */
+static int display_snapshot_settings_set(const char *name, size_t len, settings_read_cb read_cb,
+                                         void *cb_arg)
+{
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(display_snapshot, DISPLAY_SNAPSHOT_KEY, NULL,
+                               display_snapshot_settings_set, NULL, NULL);
+
+int display_manager_restore_snapshot(void)
+{
+    if (!display_initialized) {
+        return -ENODEV;
+    }
+
+    if (loaded_snapshot.ears == 0) {
+        LOG_DBG("No display snapshot");
+        return -ENOENT;
+    }
+
+    k_mutex_lock(&display_mutex, K_FOREVER);
+    for (int i = 0; i < 2; i++) {
+        const struct display_snapshot_ear *ear = &loaded_snapshot.ear[i];
+        struct display_state *state = &device_display_state[i];
+
+        if (!(loaded_snapshot.ears & BIT(i))) {
+            continue;
+        }
+
+        state->volume = ear->volume;
+        state->mute = ear->mute;
+        state->battery_level = ear->battery_level;
+        state->active_preset = ear->active_preset;
+        strncpy(state->preset_name, ear->preset_name, sizeof(state->preset_name) - 1);
+        state->preset_name[sizeof(state->preset_name) - 1] = '\0';
+        state->has_data = true;
+        state->stale = DISPLAY_STALE_VOLUME | DISPLAY_STALE_BATTERY | DISPLAY_STALE_PRESET;
+    }
+    snapshot_shown_at = k_uptime_get();
+    k_mutex_unlock(&display_mutex);
+
+    trigger_update();
 
+    LOG_INF("Display snapshot shown %lld ms after boot (ears 0x%02X)", k_uptime_get(),
+            loaded_snapshot.ears);
+    return 0;
+}
+
+int display_manager_delete_snapshot(void)
+{
+    int err = settings_delete(DISPLAY_SNAPSHOT_KEY);
+    if (err) {
+        LOG_ERR("Failed to delete display snapshot (err %d)", err);
+    }
+
+    memset(&loaded_snapshot, 0, sizeof(loaded_snapshot));
+
+    if (!display_initialized) {
+        return err;
+    }
+
+    k_mutex_lock(&display_mutex, K_FOREVER);
+    for (int i = 0; i < 2; i++) {
+        struct display_state *state = &device_display_state[i];
+
+        if (state->stale) {
+            state->has_data = false;
+            state->stale = 0;
+        }
+    }
+    k_mutex_unlock(&display_mutex);
+
+    trigger_update();
+
+    LOG_INF("Display snapshot deleted");
+    return err;
+}
+
+int display_manager_save_snapshot(void)
+{
+    struct display_snapshot snapshot;
+
+    if (!display_initialized) {
+        return -ENODEV;
+    }
+
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.version = DISPLAY_SNAPSHOT_VERSION;
+
+    k_mutex_lock(&display_mutex, K_FOREVER);
+    for (int i = 0; i < 2; i++) {
+        const struct display_state *state = &device_display_state[i];
+        struct display_snapshot_ear *ear = &snapshot.ear[i];
+
+        if (!state->has_data) {
+            continue;
+        }
+
+        ear->volume = state->volume;
+        ear->mute = state->mute;
+        ear->battery_level = state->battery_level;
+        ear->active_preset = state->active_preset;
+        strncpy(ear->preset_name, state->preset_name, sizeof(ear->preset_name) - 1);
+        snapshot.ears |= BIT(i);
+    }
+    k_mutex_unlock(&display_mutex);
+
+    snapshot.crc = display_snapshot_crc(&snapshot);
+
+    if (snapshot.ears == 0 || memcmp(&snapshot, &loaded_snapshot, sizeof(snapshot)) == 0) {
+        /* Nothing new to keep, spare the flash a write */
+        LOG_DBG("Display snapshot unchanged");
+        return 0;
+    }
+
+    int err = settings_save_one(DISPLAY_SNAPSHOT_KEY, &snapshot, sizeof(snapshot));
+    if (err) {
+        LOG_ERR("Failed to save display snapshot (err %d)", err);
+        return err;
+    }
+
+    memcpy(&loaded_snapshot, &snapshot, sizeof(snapshot));
+    LOG_INF("Display snapshot saved (ears 0x%02X)", snapshot.ears);
     return 0;
 }
 
@@ -105,6 +317,16 @@ void display_manager_show_status(const char *message)
         return;
     }
 
+    /**
+     * The last known state stays up for a while, an ear that does not come back must not
+     * hide the connection status for the whole wake.
+     */
+    if ((device_display_state[0].stale || device_display_state[1].stale) &&
+        k_uptime_get() - snapshot_shown_at < DISPLAY_SNAPSHOT_HOLD_MS) {
+        LOG_DBG("Status \"%s\" not shown over the display snapshot", message);
+        return;
+    }
+
     k_mutex_lock(&display_mutex, K_FOREVER);
     cfb_framebuffer_clear(display_dev, false);
 
@@ -150,6 +372,7 @@ void display_manager_update_volume(uint8_t device_id, uint8_t volume, uint8_t mu
     device_display_state[device_id].volume = volume;
     device_display_state[device_id].mute = mute;
     device_display_state[device_id].has_data = true;
+    device_display_state[device_id].stale &= ~DISPLAY_STALE_VOLUME;
     k_mutex_unlock(&display_mutex);
 
     trigger_update();
@@ -164,6 +387,7 @@ void display_manager_update_battery(uint8_t device_id, uint8_t battery_level)
     k_mutex_lock(&display_mutex, K_FOREVER);
     device_display_state[device_id].battery_level = battery_level;
     device_display_state[device_id].has_data = true;
+    device_display_state[device_id].stale &= ~DISPLAY_STALE_BATTERY;
     k_mutex_unlock(&display_mutex);
 
     trigger_update();
@@ -187,6 +411,7 @@ void display_manager_update_preset(uint8_t device_id, uint8_t preset_index, cons
                  "Preset %u", preset_index);
     }
     device_display_state[device_id].has_data = true;
+    device_display_state[device_id].stale &= ~DISPLAY_STALE_PRESET;
     k_mutex_unlock(&display_mutex);
 
     trigger_update();
@@ -494,10 +719,13 @@ void display_manager_update(void)
     cfb_framebuffer_clear(display_dev, false);
 
     /* Display battery levels at top */
-    snprintf(line_buf, sizeof(line_buf), "L:%u%%", device_display_state[0].battery_level);
+    /* '~' marks an ear still showing values from before the last power off */
+    snprintf(line_buf, sizeof(line_buf), "L:%s%u%%", device_display_state[0].stale ? "~" : "",
+             device_display_state[0].battery_level);
     cfb_print(display_dev, line_buf, 0, 0);
 
-    snprintf(line_buf, sizeof(line_buf), "R:%u%%", device_display_state[1].battery_level);
+    snprintf(line_buf, sizeof(line_buf), "R:%s%u%%", device_display_state[1].stale ? "~" : "",
+             device_display_state[1].battery_level);
     cfb_print(display_dev, line_buf, display_width - 64, 0);
 
     /* Display preset icon (32x32 pixels) centered at bottom */
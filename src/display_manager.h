@@ -6,6 +6,15 @@
 #include <zephyr/drivers/display.h>
 #include <zephyr/logging/log.h>
 
+/* Settings key of the last known state shown right after boot */
+#define DISPLAY_SNAPSHOT_KEY "harc/snapshot"
+/* Bumped whenever the layout of the snapshot changes, older snapshots are discarded */
+#define DISPLAY_SNAPSHOT_VERSION 1
+/* Preset name kept in the snapshot, including the terminating NUL */
+#define DISPLAY_SNAPSHOT_NAME_LEN 16
+/* Status messages are held back for this long after the snapshot is shown */
+#define DISPLAY_SNAPSHOT_HOLD_MS 5000
+
 /**
  * @brief Initialize the display manager and SSD1306 display
  *
@@ -66,6 +75,38 @@ void display_manager_clear(void);
  */
 void display_manager_show_status(const char *message);
 
+/**
+ * @brief Save the last known volume, mute, battery and preset of both ears
+ *
+ * Called before power off. The snapshot is only written when it differs from the one
+ * loaded at boot.
+ *
+ * @return 0 on success, negative error code on failure
+ */
+int display_manager_save_snapshot(void);
+
+/**
+ * @brief Show the snapshot saved before the last power off
+ *
+ * The restored values are marked stale until live values replace them. Status messages
+ * do not cover them for the first DISPLAY_SNAPSHOT_HOLD_MS. Called from
+ * display_manager_init(), which takes the snapshot from retained RAM or reads its key from
+ * NVS directly, so it does not wait for Bluetooth and the settings pass.
+ *
+ * @return 0 on success, -ENOENT if there is no snapshot, negative error code on failure
+ */
+int display_manager_restore_snapshot(void);
+
+/**
+ * @brief Delete the saved snapshot and drop the values restored from it
+ *
+ * Called when the bonds are cleared, so a new pairing does not start from the old
+ * set's state.
+ *
+ * @return 0 on success, negative error code on failure
+ */
+int display_manager_delete_snapshot(void);
+
 /**
  * @brief Put display into sleep mode (low power ~5 µA)
  *
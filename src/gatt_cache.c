@@ -0,0 +1,993 @@
+/**
+ * @file gatt_cache.c
+ * @brief Validation of cached GATT handles with the peer's Database Hash
+ */
+
+#include "gatt_cache.h"
+#include "ble_manager.h"
+#include "devices_manager.h"
+#include "vcp_settings.h"
+#include "bas_settings.h"
+#include "has_settings.h"
+#include "csip_settings.h"
+#include "retained_state.h"
+
+#include <zephyr/settings/settings.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/crc.h>
+#include <stddef.h>
+#include <string.h>
+
+LOG_MODULE_REGISTER(gatt_cache, LOG_LEVEL_INF);
+
+BUILD_ASSERT(GATT_CACHE_SIRK_SIZE == CSIP_SIRK_SIZE, "SIRK size mismatch");
+
+/* Read parameters for the Database Hash, per device since both links can validate at once */
+static struct bt_gatt_read_params db_hash_read_params[CONFIG_BT_MAX_CONN];
+static const struct bt_uuid_16 db_hash_uuid = BT_UUID_INIT_16(BT_UUID_GATT_DB_HASH_VAL);
+
+/* Device Information reads, the model number first and the firmware revision second */
+static struct bt_gatt_read_params dis_model_params[CONFIG_BT_MAX_CONN];
+static struct bt_gatt_read_params dis_firmware_params[CONFIG_BT_MAX_CONN];
+static struct gatt_cache_dis dis_pending[CONFIG_BT_MAX_CONN];
+static const struct bt_uuid_16 dis_model_uuid = BT_UUID_INIT_16(BT_UUID_DIS_MODEL_NUMBER_VAL);
+static const struct bt_uuid_16 dis_firmware_uuid =
+	BT_UUID_INIT_16(BT_UUID_DIS_FIRMWARE_REVISION_VAL);
+
+/**
+ * @brief Record as stored in NVS
+ *
+ * The CRC covers everything before it. Records are always zeroed before they are filled
+ * in, so the padding is part of the CRC too.
+ *
+ * In RAM the record holds every section. In NVS the CSIP section is kept under its own
+ * key, see struct gatt_cache_csip_record, and csip is only read from records written
+ * before that.
+ */
+struct gatt_cache_record {
+	uint8_t version;
+	uint8_t sections; /* BIT(enum gatt_cache_section) of the valid sections */
+	struct bt_vcp_vol_ctlr_handles vcp;
+	struct bt_bas_handles bas;
+	struct has_cached_data has;
+	uint8_t db_hash[GATT_DB_HASH_SIZE];
+	struct gatt_cache_csip csip;
+	struct bt_csip_set_coordinator_handles csis;
+	struct gatt_cache_dis dis;
+	uint32_t crc;
+};
+
+/**
+ * @brief SIRK and rank as stored in NVS under "harc/device/<addr>/csip"
+ *
+ * Unlike the handles, set membership cannot be rediscovered on a relink, so it is kept
+ * out of the versioned record and survives layout changes of it. The CRC covers
+ * everything before it.
+ */
+struct gatt_cache_csip_record {
+	struct gatt_cache_csip csip;
+	uint32_t crc;
+};
+
+struct gatt_cache_section_info {
+	size_t offset;
+	size_t size;
+};
+
+static const struct gatt_cache_section_info section_info[GATT_CACHE_SECTION_COUNT] = {
+	[GATT_CACHE_VCP] = {offsetof(struct gatt_cache_record, vcp),
+			    sizeof(struct bt_vcp_vol_ctlr_handles)},
+	[GATT_CACHE_BAS] = {offsetof(struct gatt_cache_record, bas), sizeof(struct bt_bas_handles)},
+	[GATT_CACHE_HAS] = {offsetof(struct gatt_cache_record, has), sizeof(struct has_cached_data)},
+	[GATT_CACHE_DB_HASH] = {offsetof(struct gatt_cache_record, db_hash), GATT_DB_HASH_SIZE},
+	[GATT_CACHE_CSIP] = {offsetof(struct gatt_cache_record, csip),
+			     sizeof(struct gatt_cache_csip)},
+	[GATT_CACHE_CSIS] = {offsetof(struct gatt_cache_record, csis),
+			     sizeof(struct bt_csip_set_coordinator_handles)},
+	[GATT_CACHE_DIS] = {offsetof(struct gatt_cache_record, dis), sizeof(struct gatt_cache_dis)},
+};
+
+/* RAM copy of the records, one per bonded device, kept through System OFF */
+struct gatt_cache_entry {
+	bool loaded;
+	bt_addr_le_t addr;
+	struct gatt_cache_record record;
+};
+
+static __noinit struct gatt_cache_entry cache_entries[CONFIG_BT_MAX_PAIRED];
+static __noinit struct retained_seal cache_seal;
+static bool cache_restored;
+/* Set once the settings pass at boot put every record in RAM */
+static bool cache_preloaded;
+/* The pass found legacy keys or more records than RAM entries, lookups walk NVS instead */
+static bool preload_incomplete;
+static uint8_t preloaded_records;
+/* BIT(index) of the entries filled by the settings pass, the others were kept in RAM */
+static uint32_t preload_filled;
+/* BIT(index) of the entries filled by the settings pass and not looked up yet */
+static uint32_t preload_unused;
+/* Lookups the settings pass answered, each one cost an NVS walk before it */
+static uint32_t nvs_walks_avoided;
+static uint8_t next_evict;
+static uint32_t nvs_loads;
+static K_MUTEX_DEFINE(cache_mutex);
+
+static uint32_t gatt_cache_record_crc(const struct gatt_cache_record *record)
+{
+	return crc32_ieee((const uint8_t *)record, offsetof(struct gatt_cache_record, crc));
+}
+
+static uint32_t gatt_cache_csip_crc(const struct gatt_cache_csip_record *record)
+{
+	return crc32_ieee((const uint8_t *)record, offsetof(struct gatt_cache_csip_record, crc));
+}
+
+static void gatt_cache_key(const bt_addr_le_t *addr, const char *leaf, char *key, size_t size)
+{
+	char addr_str[BT_ADDR_LE_STR_LEN];
+	bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
+
+	if (leaf) {
+		snprintk(key, size, "harc/device/%s/%s", addr_str, leaf);
+	} else {
+		snprintk(key, size, "harc/device/%s", addr_str);
+	}
+}
+
+/* Keys written by firmware that kept one key per service */
+static const char *const legacy_keys[] = {
+	"vcp_handles", "bas_handles", "has_cache", "has_handles", "db_hash", "sirk", "rank",
+};
+
+/* Context for settings load callback */
+struct gatt_cache_load_context {
+	struct gatt_cache_record *record;
+	bool found;
+	struct gatt_cache_csip_record csip;
+	bool csip_found;
+	bool csip_in_record; /* Written before the CSIP section got its own key */
+	struct gatt_cache_record legacy;
+	bool legacy_sirk;
+	bool legacy_rank;
+	bool legacy_found;
+};
+
+/* Reads a legacy per-service value of the expected size into the migration record */
+static bool gatt_cache_read_legacy(size_t len, settings_read_cb read_cb, void *cb_arg,
+				   void *data, size_t size)
+{
+	if (len != size) {
+		LOG_WRN("Invalid legacy cache entry size: %zu (expected %zu)", len, size);
+		return false;
+	}
+
+	return read_cb(cb_arg, data, size) == size;
+}
+
+/* Settings load callback for the cache record and the legacy keys */
+static int gatt_cache_load_cb(const char *key, size_t len, settings_read_cb read_cb,
+			      void *cb_arg, void *param)
+{
+	struct gatt_cache_load_context *ctx = (struct gatt_cache_load_context *)param;
+	struct gatt_cache_record *legacy = &ctx->legacy;
+	const char *name;
+
+	if (!key) {
+		return 0;
+	}
+
+	/* Extract the leaf name from the key (after last '/') */
+	name = strrchr(key, '/');
+	if (name) {
+		name++; /* Skip the '/' */
+	} else {
+		name = key;
+	}
+
+	if (strcmp(name, "gatt") == 0) {
+		if (len != sizeof(struct gatt_cache_record)) {
+			LOG_WRN("Invalid GATT cache record size: %zu (expected %zu)", len,
+				sizeof(struct gatt_cache_record));
+			return 0;
+		}
+
+		read_cb(cb_arg, ctx->record, sizeof(struct gatt_cache_record));
+		if (ctx->record->version != GATT_CACHE_RECORD_VERSION) {
+			LOG_WRN("Discarding GATT cache record version %u", ctx->record->version);
+		} else if (ctx->record->crc != gatt_cache_record_crc(ctx->record)) {
+			LOG_WRN("Discarding GATT cache record with bad CRC");
+		} else {
+			ctx->found = true;
+			ctx->csip_in_record = ctx->record->sections & BIT(GATT_CACHE_CSIP);
+		}
+		return 0;
+	}
+
+	if (strcmp(name, "csip") == 0) {
+		if (len != sizeof(ctx->csip) ||
+		    read_cb(cb_arg, &ctx->csip, sizeof(ctx->csip)) != sizeof(ctx->csip) ||
+		    ctx->csip.crc != gatt_cache_csip_crc(&ctx->csip)) {
+			LOG_WRN("Discarding invalid CSIP cache entry");
+		} else {
+			ctx->csip_found = true;
+		}
+		return 0;
+	}
+
+	if (strcmp(name, "vcp_handles") == 0) {
+		if (gatt_cache_read_legacy(len, read_cb, cb_arg, &legacy->vcp, sizeof(legacy->vcp))) {
+			legacy->sections |= BIT(GATT_CACHE_VCP);
+		}
+	} else if (strcmp(name, "bas_handles") == 0) {
+		if (gatt_cache_read_legacy(len, read_cb, cb_arg, &legacy->bas, sizeof(legacy->bas))) {
+			legacy->sections |= BIT(GATT_CACHE_BAS);
+		}
+	} else if (strcmp(name, "has_cache") == 0) {
+		if (gatt_cache_read_legacy(len, read_cb, cb_arg, &legacy->has, sizeof(legacy->has))) {
+			legacy->sections |= BIT(GATT_CACHE_HAS);
+		}
+	} else if (strcmp(name, "has_handles") == 0) {
+		/* Oldest format, handles without the features byte */
+		if (!(legacy->sections & BIT(GATT_CACHE_HAS)) &&
+		    gatt_cache_read_legacy(len, read_cb, cb_arg, &legacy->has.handles,
+					   sizeof(legacy->has.handles))) {
+			legacy->has.features = 0;
+			legacy->sections |= BIT(GATT_CACHE_HAS);
+		}
+	} else if (strcmp(name, "db_hash") == 0) {
+		if (gatt_cache_read_legacy(len, read_cb, cb_arg, legacy->db_hash,
+					   sizeof(legacy->db_hash))) {
+			legacy->sections |= BIT(GATT_CACHE_DB_HASH);
+		}
+	} else if (strcmp(name, "sirk") == 0) {
+		ctx->legacy_sirk = gatt_cache_read_legacy(len, read_cb, cb_arg, legacy->csip.sirk,
+							  sizeof(legacy->csip.sirk));
+	} else if (strcmp(name, "rank") == 0) {
+		ctx->legacy_rank = gatt_cache_read_legacy(len, read_cb, cb_arg, &legacy->csip.rank,
+							  sizeof(legacy->csip.rank));
+	} else {
+		return 0;
+	}
+
+	ctx->legacy_found = true;
+	return 0;
+}
+
+/* Writes the SIRK and rank of an entry to NVS, or deletes them when not cached */
+static int gatt_cache_save_csip(struct gatt_cache_entry *entry)
+{
+	struct gatt_cache_csip_record csip;
+	char key[64];
+	int err;
+
+	gatt_cache_key(&entry->addr, "csip", key, sizeof(key));
+
+	if (!(entry->record.sections & BIT(GATT_CACHE_CSIP))) {
+		err = settings_delete(key);
+	} else {
+		memset(&csip, 0, sizeof(csip));
+		memcpy(&csip.csip, &entry->record.csip, sizeof(csip.csip));
+		csip.crc = gatt_cache_csip_crc(&csip);
+		err = settings_save_one(key, &csip, sizeof(csip));
+	}
+
+	if (err) {
+		LOG_ERR("Failed to save CSIP cache entry at %s (err %d)", key, err);
+	}
+
+	return err;
+}
+
+/* Writes the record of an entry without the CSIP section, or deletes it once empty */
+static int gatt_cache_save_record(struct gatt_cache_entry *entry)
+{
+	struct gatt_cache_record record;
+	char key[64];
+	int err;
+
+	gatt_cache_key(&entry->addr, "gatt", key, sizeof(key));
+
+	memcpy(&record, &entry->record, sizeof(record));
+	record.sections &= ~BIT(GATT_CACHE_CSIP);
+	memset(&record.csip, 0, sizeof(record.csip));
+
+	if (record.sections == 0) {
+		err = settings_delete(key);
+	} else {
+		record.version = GATT_CACHE_RECORD_VERSION;
+		record.crc = gatt_cache_record_crc(&record);
+		err = settings_save_one(key, &record, sizeof(record));
+	}
+
+	if (err) {
+		LOG_ERR("Failed to save GATT cache record at %s (err %d)", key, err);
+	}
+
+	return err;
+}
+
+/* Writes the parts of an entry's record that hold @p sections to NVS */
+static int gatt_cache_save(struct gatt_cache_entry *entry, uint32_t sections)
+{
+	int err = 0;
+
+	if (sections & BIT(GATT_CACHE_CSIP)) {
+		err = gatt_cache_save_csip(entry);
+	}
+
+	if (!err && (sections & ~BIT(GATT_CACHE_CSIP))) {
+		err = gatt_cache_save_record(entry);
+	}
+
+	return err;
+}
+
+/* Moves the values of the legacy keys into the record and deletes the keys */
+static void gatt_cache_migrate(struct gatt_cache_entry *entry,
+			       struct gatt_cache_load_context *ctx)
+{
+	struct gatt_cache_record *record = &entry->record;
+	char key[64];
+
+	memcpy(record, &ctx->legacy, sizeof(*record));
+	if (ctx->legacy_sirk && ctx->legacy_rank) {
+		record->sections |= BIT(GATT_CACHE_CSIP);
+	}
+
+	if (gatt_cache_save(entry, BIT_MASK(GATT_CACHE_SECTION_COUNT)) != 0) {
+		/* Keep the legacy keys, the migration is retried on the next wake */
+		return;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(legacy_keys); i++) {
+		gatt_cache_key(&entry->addr, legacy_keys[i], key, sizeof(key));
+		settings_delete(key);
+	}
+
+	LOG_INF("Migrated legacy cache keys into one record (sections 0x%02X)", record->sections);
+}
+
+/**
+ * @brief Take over the RAM entries kept through System OFF, or start without any
+ *
+ * Must be called with cache_mutex held.
+ */
+static void gatt_cache_restore(void)
+{
+	if (!cache_restored) {
+		retained_state_restore("GATT cache", &cache_seal, cache_entries,
+				       sizeof(cache_entries));
+		cache_restored = true;
+	}
+}
+
+/**
+ * @brief Find the RAM entry of a device, reading its record from NVS on first use
+ *
+ * After the settings pass at boot the entries already hold every record and NVS is not read.
+ * Must be called with cache_mutex held.
+ */
+static struct gatt_cache_entry *gatt_cache_entry_get(const bt_addr_le_t *addr)
+{
+	struct gatt_cache_entry *entry = NULL;
+
+	gatt_cache_restore();
+
+	for (size_t i = 0; i < ARRAY_SIZE(cache_entries); i++) {
+		if (cache_entries[i].loaded && bt_addr_le_eq(&cache_entries[i].addr, addr)) {
+			if (preload_unused & BIT(i)) {
+				preload_unused &= ~BIT(i);
+				nvs_walks_avoided++;
+				LOG_DBG("GATT cache record from the settings pass, %u NVS walks avoided",
+					nvs_walks_avoided);
+			}
+			return &cache_entries[i];
+		}
+		if (!entry && !cache_entries[i].loaded) {
+			entry = &cache_entries[i];
+		}
+	}
+
+	if (!entry) {
+		preload_unused &= ~BIT(next_evict);
+		entry = &cache_entries[next_evict];
+		next_evict = (next_evict + 1) % ARRAY_SIZE(cache_entries);
+		/* The evicted record is no longer in RAM, so a miss no longer means no record */
+		cache_preloaded = false;
+	}
+
+	memset(entry, 0, sizeof(*entry));
+	bt_addr_le_copy(&entry->addr, addr);
+
+	if (cache_preloaded) {
+		/* The settings pass saw every record, a device without one has nothing cached */
+		entry->loaded = true;
+		nvs_walks_avoided++;
+		LOG_DBG("No GATT cache record per the settings pass, %u NVS walks avoided",
+			nvs_walks_avoided);
+		return entry;
+	}
+
+	struct gatt_cache_load_context ctx = {
+		.record = &entry->record,
+	};
+	char key_base[64];
+	uint32_t start = k_cycle_get_32();
+
+	gatt_cache_key(addr, NULL, key_base, sizeof(key_base));
+
+	/* One walk picks up the record and, from older firmware, the per-service keys */
+	int err = settings_load_subtree_direct(key_base, gatt_cache_load_cb, &ctx);
+	if (err) {
+		LOG_DBG("Failed to load settings at %s (err %d)", key_base, err);
+	}
+
+	nvs_loads++;
+	entry->loaded = true;
+
+	if (!ctx.found) {
+		memset(&entry->record, 0, sizeof(entry->record));
+		if (ctx.legacy_found) {
+			gatt_cache_migrate(entry, &ctx);
+		}
+	}
+
+	/* Set membership is kept even when the record was discarded for its layout */
+	if (ctx.csip_found) {
+		memcpy(&entry->record.csip, &ctx.csip.csip, sizeof(entry->record.csip));
+		entry->record.sections |= BIT(GATT_CACHE_CSIP);
+	}
+
+	if (ctx.csip_in_record) {
+		/* Move SIRK and rank to their own key, the record is rewritten without them */
+		gatt_cache_save(entry, BIT_MASK(GATT_CACHE_SECTION_COUNT));
+	}
+
+	LOG_INF("Loaded GATT cache record at %s (sections 0x%02X) in %u us, %u NVS loads this wake",
+		key_base, entry->record.sections,
+		k_cyc_to_us_floor32(k_cycle_get_32() - start), nvs_loads);
+
+	return entry;
+}
+
+/* Parses the "<addr>" component of a key below "harc/device" as written by gatt_cache_key() */
+static int gatt_cache_parse_addr(const char *name, bt_addr_le_t *addr, const char **next)
+{
+	char str[BT_ADDR_LE_STR_LEN];
+	char *type;
+	int len = settings_name_next(name, next);
+
+	if (len <= 0 || (size_t)len >= sizeof(str)) {
+		return -EINVAL;
+	}
+
+	memcpy(str, name, len);
+	str[len] = '\0';
+
+	/* "XX:XX:XX:XX:XX:XX (type)" */
+	type = strchr(str, ' ');
+	if (!type || type[1] != '(' || str[len - 1] != ')') {
+		return -EINVAL;
+	}
+
+	*type = '\0';
+	type += 2;
+	str[len - 1] = '\0';
+
+	return bt_addr_le_from_str(str, type, addr);
+}
+
+/**
+ * @brief Find or take the RAM entry the settings pass fills for a device
+ *
+ * Must be called with cache_mutex held.
+ *
+ * @return The entry, or NULL if the device's entry was kept through System OFF or no
+ *         entry is left
+ */
+static struct gatt_cache_entry *gatt_cache_preload_entry(const bt_addr_le_t *addr)
+{
+	struct gatt_cache_entry *entry = NULL;
+
+	gatt_cache_restore();
+
+	for (size_t i = 0; i < ARRAY_SIZE(cache_entries); i++) {
+		if (cache_entries[i].loaded && bt_addr_le_eq(&cache_entries[i].addr, addr)) {
+			return (preload_filled & BIT(i)) ? &cache_entries[i] : NULL;
+		}
+		if (!entry && !cache_entries[i].loaded) {
+			entry = &cache_entries[i];
+		}
+	}
+
+	if (!entry) {
+		LOG_WRN("No RAM entry left for the GATT cache of a bonded device");
+		preload_incomplete = true;
+		return NULL;
+	}
+
+	memset(entry, 0, sizeof(*entry));
+	bt_addr_le_copy(&entry->addr, addr);
+	entry->loaded = true;
+	preload_filled |= BIT(entry - cache_entries);
+
+	return entry;
+}
+
+/**
+ * @brief Settings handler for "harc/device", called for each key by the settings pass at boot
+ *
+ * Valid records go straight into the RAM entries. Entries kept through System OFF win over
+ * NVS, they were written back before power off.
+ */
+static int gatt_cache_settings_set(const char *name, size_t len, settings_read_cb read_cb,
+				   void *cb_arg)
+{
+	const char *leaf;
+	bt_addr_le_t addr;
+
+	if (!name || gatt_cache_parse_addr(name, &addr, &leaf) != 0 || !leaf) {
+		LOG_WRN("Ignoring settings key harc/device/%s", name ? name : "");
+		return 0;
+	}
+
+	if (strcmp(leaf, "presets") == 0) {
+		char key[64];
+
+		snprintk(key, sizeof(key), "harc/device/%s", name);
+		return has_settings_preload_presets(key, len, read_cb, cb_arg);
+	}
+
+	if (strcmp(leaf, "gatt") != 0 && strcmp(leaf, "csip") != 0) {
+		for (size_t i = 0; i < ARRAY_SIZE(legacy_keys); i++) {
+			if (strcmp(leaf, legacy_keys[i]) == 0) {
+				/* Migrated by the walk of the first lookup */
+				preload_incomplete = true;
+			}
+		}
+		return 0;
+	}
+
+	struct gatt_cache_record record;
+	struct gatt_cache_load_context ctx = {
+		.record = &record,
+	};
+
+	gatt_cache_load_cb(leaf, len, read_cb, cb_arg, &ctx);
+	if (ctx.csip_in_record) {
+		/* Moved to its own key by the walk of the first lookup */
+		preload_incomplete = true;
+		return 0;
+	}
+	if (!ctx.found && !ctx.csip_found) {
+		return 0;
+	}
+
+	k_mutex_lock(&cache_mutex, K_FOREVER);
+
+	struct gatt_cache_entry *entry = gatt_cache_preload_entry(&addr);
+
+	if (!entry) {
+		k_mutex_unlock(&cache_mutex);
+		return 0;
+	}
+
+	if (ctx.found) {
+		/* The CSIP section may have come first, from its own key */
+		record.sections |= entry->record.sections & BIT(GATT_CACHE_CSIP);
+		memcpy(&record.csip, &entry->record.csip, sizeof(record.csip));
+		memcpy(&entry->record, &record, sizeof(record));
+		preloaded_records++;
+	} else {
+		memcpy(&entry->record.csip, &ctx.csip.csip, sizeof(entry->record.csip));
+		entry->record.sections |= BIT(GATT_CACHE_CSIP);
+	}
+
+	k_mutex_unlock(&cache_mutex);
+	return 0;
+}
+
+static int gatt_cache_settings_commit(void)
+{
+	k_mutex_lock(&cache_mutex, K_FOREVER);
+
+	gatt_cache_restore();
+	cache_preloaded = !preload_incomplete;
+	preload_unused = preload_filled;
+
+	k_mutex_unlock(&cache_mutex);
+
+	LOG_INF("Settings pass loaded %u GATT cache records%s", preloaded_records,
+		cache_preloaded ? "" : ", remaining lookups read NVS");
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(gatt_cache, "harc/device", NULL, gatt_cache_settings_set,
+			       gatt_cache_settings_commit, NULL);
+
+/**
+ * @brief Store one section of a device's cache record
+ */
+int gatt_cache_update(const bt_addr_le_t *addr, enum gatt_cache_section section,
+		      const void *data, size_t len)
+{
+	if (!addr || !data || section >= GATT_CACHE_SECTION_COUNT ||
+	    len != section_info[section].size) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&cache_mutex, K_FOREVER);
+
+	struct gatt_cache_entry *entry = gatt_cache_entry_get(addr);
+	uint8_t *record = (uint8_t *)&entry->record;
+
+	memcpy(record + section_info[section].offset, data, len);
+	entry->record.sections |= BIT(section);
+	int err = gatt_cache_save(entry, BIT(section));
+
+	k_mutex_unlock(&cache_mutex);
+	return err;
+}
+
+/**
+ * @brief Load one section of a device's cache record
+ */
+int gatt_cache_lookup(const bt_addr_le_t *addr, enum gatt_cache_section section, void *data,
+		      size_t len)
+{
+	if (!addr || !data || section >= GATT_CACHE_SECTION_COUNT ||
+	    len != section_info[section].size) {
+		return -EINVAL;
+	}
+
+	int err = -ENOENT;
+
+	k_mutex_lock(&cache_mutex, K_FOREVER);
+
+	struct gatt_cache_entry *entry = gatt_cache_entry_get(addr);
+	const uint8_t *record = (const uint8_t *)&entry->record;
+
+	if (entry->record.sections & BIT(section)) {
+		memcpy(data, record + section_info[section].offset, len);
+		err = 0;
+	}
+
+	k_mutex_unlock(&cache_mutex);
+	return err;
+}
+
+/**
+ * @brief Drop sections of a device's cache record
+ */
+int gatt_cache_invalidate(const bt_addr_le_t *addr, uint32_t sections)
+{
+	if (!addr) {
+		return -EINVAL;
+	}
+
+	int err = 0;
+
+	k_mutex_lock(&cache_mutex, K_FOREVER);
+
+	struct gatt_cache_entry *entry = gatt_cache_entry_get(addr);
+
+	uint32_t dropped = entry->record.sections & sections;
+
+	if (dropped) {
+		entry->record.sections &= ~sections;
+		err = gatt_cache_save(entry, dropped);
+	}
+
+	k_mutex_unlock(&cache_mutex);
+	return err;
+}
+
+/**
+ * @brief Delete a device's cache record and preset list from RAM and NVS
+ */
+int gatt_cache_delete(const bt_addr_le_t *addr)
+{
+	if (!addr) {
+		return -EINVAL;
+	}
+
+	char key[64];
+
+	/* Looks up the set by the bond, so before the bond is removed */
+	has_settings_clear_presets(addr);
+
+	k_mutex_lock(&cache_mutex, K_FOREVER);
+
+	gatt_cache_restore();
+	for (size_t i = 0; i < ARRAY_SIZE(cache_entries); i++) {
+		if (cache_entries[i].loaded && bt_addr_le_eq(&cache_entries[i].addr, addr)) {
+			memset(&cache_entries[i], 0, sizeof(cache_entries[i]));
+			preload_unused &= ~BIT(i);
+		}
+	}
+
+	/* Keys of a device that was never loaded by this firmware may still be around */
+	for (size_t i = 0; i < ARRAY_SIZE(legacy_keys); i++) {
+		gatt_cache_key(addr, legacy_keys[i], key, sizeof(key));
+		settings_delete(key);
+	}
+
+	gatt_cache_key(addr, "csip", key, sizeof(key));
+	int err = settings_delete(key);
+
+	gatt_cache_key(addr, "gatt", key, sizeof(key));
+	if (!err) {
+		err = settings_delete(key);
+	}
+
+	k_mutex_unlock(&cache_mutex);
+
+	if (err) {
+		LOG_ERR("Failed to delete GATT cache record at %s (err %d)", key, err);
+		return err;
+	}
+
+	LOG_INF("Deleted GATT cache record at %s", key);
+	return 0;
+}
+
+/**
+ * @brief Store a section of a device's cache record for the other members of its set
+ */
+int gatt_cache_share_with_set(const bt_addr_le_t *addr, enum gatt_cache_section section,
+			      const void *data, size_t len)
+{
+	struct bond_collection collection;
+	struct bonded_device_entry current_entry;
+	struct gatt_cache_dis dis;
+	struct gatt_cache_dis member_dis;
+	int shared = 0;
+
+	if (!addr || !data) {
+		return -EINVAL;
+	}
+
+	if (devices_manager_get_bonded_devices_collection(&collection) != 0 ||
+	    !devices_manager_find_bonded_entry_by_addr(addr, &current_entry) ||
+	    !current_entry.is_set_member) {
+		return 0;
+	}
+
+	if (gatt_cache_lookup(addr, GATT_CACHE_DIS, &dis, sizeof(dis)) != 0) {
+		LOG_DBG("No Device Information cached, not sharing section %d", section);
+		return 0;
+	}
+
+	for (uint8_t i = 0; i < collection.count; i++) {
+		const struct bonded_device_entry *member = &collection.devices[i];
+		char addr_str[BT_ADDR_LE_STR_LEN];
+
+		/* Skip the current device and devices outside its CSIP set */
+		if (bt_addr_le_eq(&member->addr, addr) || !member->is_set_member ||
+		    memcmp(member->sirk, current_entry.sirk, CSIP_SIRK_SIZE) != 0) {
+			continue;
+		}
+
+		bt_addr_le_to_str(&member->addr, addr_str, sizeof(addr_str));
+
+		/* Identical GATT layouts are only assumed for the same model and firmware */
+		if (gatt_cache_lookup(&member->addr, GATT_CACHE_DIS, &member_dis,
+				      sizeof(member_dis)) != 0 ||
+		    memcmp(&member_dis, &dis, sizeof(dis)) != 0) {
+			LOG_INF("Set member %s runs different or unknown firmware, "
+				"not sharing section %d", addr_str, section);
+			continue;
+		}
+
+		int err = gatt_cache_update(&member->addr, section, data, len);
+		if (err) {
+			LOG_WRN("Failed to share section %d with set member %s (err %d)", section,
+				addr_str, err);
+			continue;
+		}
+
+		LOG_INF("Section %d also cached for set member %s", section, addr_str);
+		shared++;
+	}
+
+	return shared;
+}
+
+/**
+ * @brief Store the Database Hash the cached handles belong to
+ */
+int gatt_cache_store_db_hash(const bt_addr_le_t *addr, const uint8_t hash[GATT_DB_HASH_SIZE])
+{
+	return gatt_cache_update(addr, GATT_CACHE_DB_HASH, hash, GATT_DB_HASH_SIZE);
+}
+
+/**
+ * @brief Load the Database Hash the cached handles belong to
+ */
+int gatt_cache_load_db_hash(const bt_addr_le_t *addr, uint8_t hash[GATT_DB_HASH_SIZE])
+{
+	return gatt_cache_lookup(addr, GATT_CACHE_DB_HASH, hash, GATT_DB_HASH_SIZE);
+}
+
+/**
+ * @brief Clear the Database Hash, all cached handles and the cached preset list
+ */
+void gatt_cache_clear(const bt_addr_le_t *addr)
+{
+	char addr_str[BT_ADDR_LE_STR_LEN];
+	bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
+
+	/* Preset indexes belong to the database too. Cleared first, the key of the list
+	 * depends on the HAS features cached in the record. */
+	has_settings_clear_presets(addr);
+
+	gatt_cache_invalidate(addr, GATT_CACHE_DB_SECTIONS);
+
+	LOG_INF("Cleared GATT cache for %s", addr_str);
+}
+
+/* Read callback for the Database Hash characteristic */
+static uint8_t db_hash_read_cb(struct bt_conn *conn, uint8_t err,
+			       struct bt_gatt_read_params *params, const void *data,
+			       uint16_t length)
+{
+	struct device_context *ctx = devices_manager_get_device_context_by_conn(conn);
+	/* The identity address after pairing, the bond and its cache record are keyed by it */
+	const bt_addr_le_t *addr = bt_conn_get_dst(conn);
+	uint8_t cached_hash[GATT_DB_HASH_SIZE];
+
+	if (!ctx) {
+		return BT_GATT_ITER_STOP;
+	}
+
+	if (err) {
+		/* Peers without a Database Hash keep the old behaviour of trusting the cache */
+		LOG_WRN("Database Hash read failed (err 0x%02X), keeping cached handles "
+			"[DEVICE ID %d]",
+			err, ctx->device_id);
+		ble_cmd_complete(ctx->device_id, 0);
+		return BT_GATT_ITER_STOP;
+	}
+
+	if (!data) {
+		/* End of a read by UUID without a value */
+		LOG_WRN("No Database Hash on peer, keeping cached handles [DEVICE ID %d]",
+			ctx->device_id);
+		ble_cmd_complete(ctx->device_id, 0);
+		return BT_GATT_ITER_STOP;
+	}
+
+	if (length != GATT_DB_HASH_SIZE) {
+		LOG_WRN("Unexpected Database Hash length %u [DEVICE ID %d]", length,
+			ctx->device_id);
+		ble_cmd_complete(ctx->device_id, 0);
+		return BT_GATT_ITER_STOP;
+	}
+
+	if (gatt_cache_load_db_hash(addr, cached_hash) == 0 &&
+	    memcmp(cached_hash, data, GATT_DB_HASH_SIZE) == 0) {
+		LOG_INF("Database Hash matches, cached handles are valid [DEVICE ID %d]",
+			ctx->device_id);
+	} else {
+		LOG_INF("Database Hash changed or unknown, dropping cached handles [DEVICE ID %d]",
+			ctx->device_id);
+		gatt_cache_clear(addr);
+		gatt_cache_store_db_hash(addr, data);
+	}
+
+	ble_cmd_complete(ctx->device_id, 0);
+	return BT_GATT_ITER_STOP;
+}
+
+/**
+ * @brief Command: Validate the cached handles of a connected device
+ */
+int gatt_cache_cmd_validate(uint8_t device_id)
+{
+	struct device_context *ctx = devices_manager_get_device_context_by_id(device_id);
+
+	if (!ctx || !ctx->conn) {
+		LOG_ERR("No active connection [DEVICE ID %d]", device_id);
+		return -ENOTCONN;
+	}
+
+	struct bt_gatt_read_params *params = &db_hash_read_params[device_id];
+
+	params->func = db_hash_read_cb;
+	params->handle_count = 0;
+	params->by_uuid.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+	params->by_uuid.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+	params->by_uuid.uuid = &db_hash_uuid.uuid;
+
+	LOG_DBG("Reading Database Hash [DEVICE ID %d]", device_id);
+	return bt_gatt_read(ctx->conn, params);
+}
+
+/* Copies a Device Information string, which is not NUL terminated on air */
+static void dis_copy_string(char *dst, const void *data, uint16_t length)
+{
+	size_t len = MIN(length, GATT_CACHE_DIS_STR_LEN - 1);
+
+	memcpy(dst, data, len);
+	dst[len] = '\0';
+}
+
+/* Read callback for the Device Information strings */
+static uint8_t dis_read_cb(struct bt_conn *conn, uint8_t err, struct bt_gatt_read_params *params,
+			   const void *data, uint16_t length)
+{
+	struct device_context *ctx = devices_manager_get_device_context_by_conn(conn);
+
+	if (!ctx) {
+		return BT_GATT_ITER_STOP;
+	}
+
+	struct gatt_cache_dis *dis = &dis_pending[ctx->device_id];
+	bool model = (params == &dis_model_params[ctx->device_id]);
+
+	if (err) {
+		/* An absent string is kept empty, it still has to match the other ear */
+		LOG_DBG("Device Information read failed (err 0x%02X) [DEVICE ID %d]", err,
+			ctx->device_id);
+	} else if (data) {
+		dis_copy_string(model ? dis->model : dis->firmware, data, length);
+	}
+
+	if (model) {
+		struct bt_gatt_read_params *fw_params = &dis_firmware_params[ctx->device_id];
+
+		fw_params->func = dis_read_cb;
+		fw_params->handle_count = 0;
+		fw_params->by_uuid.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+		fw_params->by_uuid.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+		fw_params->by_uuid.uuid = &dis_firmware_uuid.uuid;
+
+		int read_err = bt_gatt_read(conn, fw_params);
+		if (read_err == 0) {
+			return BT_GATT_ITER_STOP;
+		}
+
+		LOG_WRN("Failed to read firmware revision (err %d) [DEVICE ID %d]", read_err,
+			ctx->device_id);
+	}
+
+	LOG_INF("Device Information: model \"%s\", firmware \"%s\" [DEVICE ID %d]", dis->model,
+		dis->firmware, ctx->device_id);
+	gatt_cache_update(bt_conn_get_dst(conn), GATT_CACHE_DIS, dis, sizeof(*dis));
+
+	ble_cmd_complete(ctx->device_id, 0);
+	return BT_GATT_ITER_STOP;
+}
+
+/**
+ * @brief Command: Read the model number and firmware revision of a connected device
+ */
+int gatt_cache_cmd_read_dis(uint8_t device_id)
+{
+	struct device_context *ctx = devices_manager_get_device_context_by_id(device_id);
+	struct gatt_cache_dis *dis = &dis_pending[device_id];
+
+	if (!ctx || !ctx->conn) {
+		LOG_ERR("No active connection [DEVICE ID %d]", device_id);
+		return -ENOTCONN;
+	}
+
+	if (gatt_cache_lookup(bt_conn_get_dst(ctx->conn), GATT_CACHE_DIS, dis, sizeof(*dis)) == 0) {
+		LOG_DBG("Device Information cached: model \"%s\", firmware \"%s\" [DEVICE ID %d]",
+			dis->model, dis->firmware, device_id);
+		ble_cmd_complete(device_id, 0);
+		return 0;
+	}
+
+	struct bt_gatt_read_params *params = &dis_model_params[device_id];
+
+	memset(dis, 0, sizeof(*dis));
+	params->func = dis_read_cb;
+	params->handle_count = 0;
+	params->by_uuid.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+	params->by_uuid.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+	params->by_uuid.uuid = &dis_model_uuid.uuid;
+
+	LOG_DBG("Reading Device Information [DEVICE ID %d]", device_id);
+	return bt_gatt_read(ctx->conn, params);
+}
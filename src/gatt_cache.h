@@ -0,0 +1,174 @@
+/**
+ * @file gatt_cache.h
+ * @brief Per-device GATT cache record in NVS settings
+ *
+ * Everything cached about a bonded device (VCP, BAS, HAS and CSIS handles, HAS features,
+ * the CSIP SIRK and rank, the Device Information model and firmware revision, and the
+ * Database Hash the handles belong to) is kept in one
+ * versioned, CRC protected record under "harc/device/<addr>/gatt". The SIRK and rank are
+ * kept apart under "harc/device/<addr>/csip", so a layout change of the record does not
+ * drop set membership, which a relink cannot rediscover. The records are read
+ * into RAM by the settings pass at boot and served from RAM afterwards. Records written by
+ * older firmware under one key per service are migrated on the first lookup.
+ */
+
+#ifndef GATT_CACHE_H_
+#define GATT_CACHE_H_
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <stdint.h>
+
+#define GATT_DB_HASH_SIZE 16
+#define GATT_CACHE_SIRK_SIZE 16
+/* Longest Device Information string kept, including the terminating NUL */
+#define GATT_CACHE_DIS_STR_LEN 24
+
+/* Bumped whenever the layout of the record changes, older records are discarded */
+#define GATT_CACHE_RECORD_VERSION 5
+
+/**
+ * @brief Sections of the cache record
+ */
+enum gatt_cache_section {
+	GATT_CACHE_VCP,     /* struct bt_vcp_vol_ctlr_handles */
+	GATT_CACHE_BAS,     /* struct bt_bas_handles */
+	GATT_CACHE_HAS,     /* struct has_cached_data */
+	GATT_CACHE_DB_HASH, /* uint8_t[GATT_DB_HASH_SIZE] */
+	GATT_CACHE_CSIP,    /* struct gatt_cache_csip */
+	GATT_CACHE_CSIS,    /* struct bt_csip_set_coordinator_handles */
+	GATT_CACHE_DIS,     /* struct gatt_cache_dis */
+	GATT_CACHE_SECTION_COUNT,
+};
+
+/* Sections that describe the peer's GATT database and go stale with it */
+#define GATT_CACHE_DB_SECTIONS                                                                 \
+	(BIT(GATT_CACHE_VCP) | BIT(GATT_CACHE_BAS) | BIT(GATT_CACHE_HAS) |                     \
+	 BIT(GATT_CACHE_CSIS) | BIT(GATT_CACHE_DIS) | BIT(GATT_CACHE_DB_HASH))
+
+/**
+ * @brief CSIP set membership as cached for a device
+ */
+struct gatt_cache_csip {
+	uint8_t sirk[GATT_CACHE_SIRK_SIZE];
+	uint8_t rank;
+};
+
+/**
+ * @brief Device Information the cached handles were discovered with
+ *
+ * Both strings are NUL terminated and empty if the device does not expose them.
+ */
+struct gatt_cache_dis {
+	char model[GATT_CACHE_DIS_STR_LEN];
+	char firmware[GATT_CACHE_DIS_STR_LEN];
+};
+
+/**
+ * @brief Store one section of a device's cache record
+ *
+ * @param addr Bluetooth address of the device
+ * @param section Section to store
+ * @param data Section data, of the type listed in enum gatt_cache_section
+ * @param len Size of @p data
+ * @return 0 on success, negative errno on failure
+ */
+int gatt_cache_update(const bt_addr_le_t *addr, enum gatt_cache_section section,
+		      const void *data, size_t len);
+
+/**
+ * @brief Load one section of a device's cache record
+ *
+ * @param addr Bluetooth address of the device
+ * @param section Section to load
+ * @param data Buffer for the section data
+ * @param len Size of @p data
+ * @return 0 on success, -ENOENT if not cached, negative errno on failure
+ */
+int gatt_cache_lookup(const bt_addr_le_t *addr, enum gatt_cache_section section, void *data,
+		      size_t len);
+
+/**
+ * @brief Drop sections of a device's cache record
+ *
+ * @param addr Bluetooth address of the device
+ * @param sections Bit mask of BIT(enum gatt_cache_section) values
+ * @return 0 on success, negative errno on failure
+ */
+int gatt_cache_invalidate(const bt_addr_le_t *addr, uint32_t sections);
+
+/**
+ * @brief Delete a device's cache record and preset list from RAM and NVS
+ *
+ * @param addr Bluetooth address of the device
+ * @return 0 on success, negative errno on failure
+ */
+int gatt_cache_delete(const bt_addr_le_t *addr);
+
+/**
+ * @brief Store a section of a device's cache record for the other members of its set
+ *
+ * Handles discovered on one hearing aid are only valid for the other one if both run the
+ * same firmware on the same model. The section is copied to a bonded member with the same
+ * SIRK only when both devices have Device Information cached and it matches.
+ *
+ * @param addr Bluetooth address of the device the section was discovered on
+ * @param section Section to share
+ * @param data Section data, of the type listed in enum gatt_cache_section
+ * @param len Size of @p data
+ * @return Number of set members the section was stored for, negative errno on failure
+ */
+int gatt_cache_share_with_set(const bt_addr_le_t *addr, enum gatt_cache_section section,
+			      const void *data, size_t len);
+
+/**
+ * @brief Store the Database Hash the cached handles belong to
+ *
+ * @param addr Bluetooth address of the device
+ * @param hash Database Hash read from the device
+ * @return 0 on success, negative errno on failure
+ */
+int gatt_cache_store_db_hash(const bt_addr_le_t *addr, const uint8_t hash[GATT_DB_HASH_SIZE]);
+
+/**
+ * @brief Load the Database Hash the cached handles belong to
+ *
+ * @param addr Bluetooth address of the device
+ * @param hash Buffer to store the loaded hash
+ * @return 0 on success, -ENOENT if not found, negative errno on failure
+ */
+int gatt_cache_load_db_hash(const bt_addr_le_t *addr, uint8_t hash[GATT_DB_HASH_SIZE]);
+
+/**
+ * @brief Clear the Database Hash, all cached handles and the cached preset list
+ *
+ * @param addr Bluetooth address of the device
+ */
+void gatt_cache_clear(const bt_addr_le_t *addr);
+
+/**
+ * @brief Command: Validate the cached handles of a connected device
+ *
+ * Reads the Database Hash characteristic once. If it differs from the stored hash, the
+ * cached handles are dropped so the following discoveries run in full, and the new hash
+ * is stored. The command always completes without error, so the queue moves on to the
+ * discoveries either way.
+ *
+ * @param device_id Device ID
+ * @return 0 on success, negative errno if the read could not be started
+ */
+int gatt_cache_cmd_validate(uint8_t device_id);
+
+/**
+ * @brief Command: Read the model number and firmware revision of a connected device
+ *
+ * The strings are read from the Device Information Service only when they are not cached
+ * yet. Run after gatt_cache_cmd_validate(), which drops them together with the handles
+ * when the device's GATT database changed. Always completes without error.
+ *
+ * @param device_id Device ID
+ * @return 0 on success, negative errno if the read could not be started
+ */
+int gatt_cache_cmd_read_dis(uint8_t device_id);
+
+#endif /* GATT_CACHE_H_ */
@@ -1,15 +1,28 @@
 #include "has_controller.h"
 #include "has_settings.h"
+#include "gatt_cache.h"
 #include "devices_manager.h"
 #include "ble_manager.h"
 #include "app_controller.h"
 #include "display_manager.h"
+#include "csip_coordinator.h"
 
 LOG_MODULE_REGISTER(has_controller, LOG_LEVEL_DBG);
 
 /* Track whether handles were loaded from cache (per device) - skip re-storing if true */
 static bool handles_from_cache[CONFIG_BT_MAX_CONN];
 
+/* Active preset of the binaural set, mirrored from the Active Preset Index
+ * notifications of both ears, including changes made on the hearing aid or by the phone */
+static uint8_t binaural_active_index = BT_HAS_PRESET_INDEX_NONE;
+
+/* Preset command waiting for its notification (per device). The target is the index the
+ * command should activate, BT_HAS_PRESET_INDEX_NONE if it cannot be predicted. */
+static bool preset_cmd_pending[CONFIG_BT_MAX_CONN];
+static uint8_t preset_cmd_target[CONFIG_BT_MAX_CONN];
+/* Command the preset read completes, it may run in either command lane */
+static struct ble_cmd *preset_read_cmd[CONFIG_BT_MAX_CONN];
+
 /* Forward declarations */
 static void has_discover_cb(struct bt_conn *conn, int err, struct bt_has *has,
                            enum bt_has_hearing_aid_type type,
@@ -18,6 +31,11 @@ static void has_preset_read_rsp_cb(struct bt_has *has, int err,
                                    const struct bt_has_preset_record *record,
                                    bool is_last);
 static void has_preset_switch_cb(struct bt_has *has, int err, uint8_t index);
+static void has_preset_update_cb(struct bt_has *has, uint8_t index_prev,
+                                 const struct bt_has_preset_record *record, bool is_last);
+static void has_preset_deleted_cb(struct bt_has *has, uint8_t index, bool is_last);
+static void has_preset_availability_cb(struct bt_has *has, uint8_t index, bool available,
+                                       bool is_last);
 static struct device_context *get_device_context_by_has(struct bt_has *has);
 
 /* HAS client callbacks */
@@ -25,6 +43,9 @@ static struct bt_has_client_cb has_callbacks = {
     .discover = has_discover_cb,
     .preset_read_rsp = has_preset_read_rsp_cb,
     .preset_switch = has_preset_switch_cb,
+    .preset_update = has_preset_update_cb,
+    .preset_deleted = has_preset_deleted_cb,
+    .preset_availability = has_preset_availability_cb,
 };
 
 /**
@@ -61,22 +82,16 @@ static void has_discover_cb(struct bt_conn *conn, int err, struct bt_has *has,
     if (!handles_from_cache[ctx->device_id]) {
         /* Extract and cache handles and features to NVS for fast reconnection */
         struct bt_has_handles handles;
+        uint8_t features = 0;
         int cache_err = bt_has_client_get_handles(has, &handles);
         if (cache_err == 0) {
-            /* Reconstruct features byte from type and caps
-             * Note: We can't access has->features directly (opaque struct),
-             * so we reconstruct what we can from the callback parameters.
-             * The hearing aid type occupies bits 0-1.
-             * For full feature support, we'd need to read the characteristic,
-             * but this gives us enough for basic operation. */
-            uint8_t features = (uint8_t)type; /* Type is in bits 0-1 */
-
-            /* If presets are supported, the control point exists.
-             * For GN hearing aids with binaural type, preset sync is typically supported.
-             * We set bit 2 (BT_HAS_FEAT_PRESET_SYNC_SUPP) for binaural devices. */
-            if ((caps & BT_HAS_PRESET_SUPPORT) && type == BT_HAS_HEARING_AID_TYPE_BINAURAL) {
-                features |= 0x04; /* BT_HAS_FEAT_PRESET_SYNC_SUPP */
+            /* The client read the Hearing Aid Features characteristic during discovery */
+            int feat_err = bt_has_client_get_features(has, &features);
+            if (feat_err) {
+                LOG_WRN("Failed to get HAS features (err %d), preset sync disabled", feat_err);
+                features = (uint8_t)type;
             }
+            ctx->has_ctlr.features = features;
 
             /* Store handles for the current device */
             cache_err = has_settings_store_handles(&ctx->info.addr, &handles, features);
@@ -86,42 +101,12 @@ static void has_discover_cb(struct bt_conn *conn, int err, struct bt_has *has,
                 LOG_WRN("Failed to cache HAS data for current device (err %d)", cache_err);
             }
 
-            /**
-             * Store handles for all other set members
-             */
-            // LOG_DBG("is_new_device: %d [DEVICE ID %d]", ctx->info.is_new_device, ctx->device_id);
-            // if (ctx->info.is_new_device) {
-                struct bond_collection collection;
-                if (devices_manager_get_bonded_devices_collection(&collection) == 0) {
-                    struct bonded_device_entry current_entry;
-                    if (devices_manager_find_bonded_entry_by_addr(&ctx->info.addr, &current_entry) &&
-                        current_entry.is_set_member) {
-
-                        LOG_DBG("Current device is CSIP set member, caching HAS handles for all set members");
-
-                        for (uint8_t i = 0; i < collection.count; i++) {
-                            /* Skip the current device (already stored) */
-                            if (bt_addr_le_cmp(&collection.devices[i].addr, &ctx->info.addr) == 0) {
-                                continue;
-                            }
-
-                            /* Only store for devices in the same CSIP set */
-                            if (collection.devices[i].is_set_member &&
-                                memcmp(collection.devices[i].sirk, current_entry.sirk, CSIP_SIRK_SIZE) == 0) {
-
-                                int err = has_settings_store_handles(&collection.devices[i].addr, &handles, features);
-                                if (err == 0) {
-                                    char addr_str[BT_ADDR_LE_STR_LEN];
-                                    bt_addr_le_to_str(&collection.devices[i].addr, addr_str, sizeof(addr_str));
-                                    LOG_INF("HAS handles also cached for set member: %s", addr_str);
-                                } else {
-                                    LOG_WRN("Failed to cache HAS handles for set member (err %d)", err);
-                                }
-                            }
-                        }
-                    }
-                }
-            // }
+            /* Reuse the handles for the other set member if it runs the same firmware */
+            struct has_cached_data shared = {
+                .handles = handles,
+                .features = features,
+            };
+            gatt_cache_share_with_set(&ctx->info.addr, GATT_CACHE_HAS, &shared, sizeof(shared));
         } else {
             LOG_WRN("Failed to extract HAS handles (err %d)", cache_err);
         }
@@ -129,6 +114,13 @@ static void has_discover_cb(struct bt_conn *conn, int err, struct bt_has *has,
         LOG_DBG("Handles were loaded from cache, skipping re-storage");
     }
 
+    /* The preset list survives until the hearing aid reports a change */
+    if (has_settings_load_presets(&ctx->info.addr, ctx->has_ctlr.presets,
+                                  &ctx->has_ctlr.preset_count) == 0) {
+        ctx->has_ctlr.presets_read = true;
+        LOG_INF("Using %u cached presets [DEVICE ID %d]", ctx->has_ctlr.preset_count, ctx->device_id);
+    }
+
     app_controller_notify_has_discovered(ctx->device_id, 0);
     ble_cmd_complete(ctx->device_id, 0);
 }
@@ -149,13 +141,13 @@ static void has_preset_read_rsp_cb(struct bt_has *has, int err,
 
     if (err) {
         LOG_ERR("Preset read failed (err %d) [DEVICE ID %d]", err, ctx->device_id);
-        ble_cmd_complete(ctx->device_id, err);
+        ble_cmd_complete_cmd(ctx->device_id, preset_read_cmd[ctx->device_id], err);
         return;
     }
 
     if (!record) {
         LOG_DBG("No more presets to read [DEVICE ID %d]", ctx->device_id);
-        ble_cmd_complete(ctx->device_id, err);
+        ble_cmd_complete_cmd(ctx->device_id, preset_read_cmd[ctx->device_id], err);
         return;
     }
 
@@ -186,8 +178,10 @@ static void has_preset_read_rsp_cb(struct bt_has *has, int err,
     // If this is the last preset, complete the command
     if (is_last) {
         LOG_DBG("Preset read complete, total: %u", ctx->has_ctlr.preset_count);
+        has_settings_store_presets(&ctx->info.addr, ctx->has_ctlr.presets,
+                                   ctx->has_ctlr.preset_count);
         app_controller_notify_has_presets_read(ctx->device_id, 0);
-        ble_cmd_complete(ctx->device_id, 0);
+        ble_cmd_complete_cmd(ctx->device_id, preset_read_cmd[ctx->device_id], 0);
         ctx->has_ctlr.presets_read = true;
     }
 }
@@ -206,11 +200,15 @@ static void has_preset_switch_cb(struct bt_has *has, int err, uint8_t index)
 
     if (err) {
         LOG_ERR("Preset switch failed (err %d)", err);
-        ble_cmd_complete(ctx->device_id, err);
+        if (preset_cmd_pending[ctx->device_id]) {
+            preset_cmd_pending[ctx->device_id] = false;
+            ble_cmd_complete(ctx->device_id, err);
+        }
         return;
     }
 
     ctx->has_ctlr.active_preset_index = index;
+    binaural_active_index = index;
 
     // Find preset name for better logging
     char *preset_name = "Unknown";
@@ -223,17 +221,188 @@ static void has_preset_switch_cb(struct bt_has *has, int err, uint8_t index)
 
     /* Update display with new preset */
     display_manager_update_preset(ctx->device_id, index, preset_name);
+    LOG_INF("Active preset changed to %u: '%s' [DEVICE ID %d]", index, preset_name, ctx->device_id);
 
-    if (ctx->current_ble_cmd && ctx->current_ble_cmd->type) {
-        LOG_DBG("ctx->current_ble_cmd->type=%d", ctx->current_ble_cmd->type);
-            if (ctx->current_ble_cmd->type == BLE_CMD_HAS_NEXT_PRESET ||
-                ctx->current_ble_cmd->type == BLE_CMD_HAS_PREV_PRESET ||
-                ctx->current_ble_cmd->type == BLE_CMD_HAS_SET_PRESET)
-                ble_cmd_complete(ctx->device_id, 0);
-    } else {
-        LOG_DBG("ctx->current_ble_cmd->type is NULL");
+    /* A command completes on the ear it was sent to, or, when synchronized, as soon as the
+     * other ear reports the expected preset */
+    for (uint8_t i = 0; i < CONFIG_BT_MAX_CONN; i++) {
+        struct device_context *pending = devices_manager_get_device_context_by_id(i);
+
+        if (!preset_cmd_pending[i] || !pending) {
+            continue;
+        }
+
+        if (pending != ctx &&
+            (!has_preset_sync_supported(i) || preset_cmd_target[i] != index)) {
+            continue;
+        }
+
+        preset_cmd_pending[i] = false;
+        if (pending->current_ble_cmd &&
+            (pending->current_ble_cmd->type == BLE_CMD_HAS_NEXT_PRESET ||
+             pending->current_ble_cmd->type == BLE_CMD_HAS_PREV_PRESET ||
+             pending->current_ble_cmd->type == BLE_CMD_HAS_SET_PRESET)) {
+            ble_cmd_complete(i, 0);
+        }
     }
-    LOG_INF("Active preset changed to %u: '%s' [DEVICE ID %d]", index, preset_name, ctx->device_id);
+}
+
+/**
+ * @brief Index the next or previous preset command is expected to activate
+ *
+ * Follows the preset list in index order and wraps around, skipping unavailable presets.
+ *
+ * @return Expected index, BT_HAS_PRESET_INDEX_NONE if it cannot be predicted
+ */
+static uint8_t has_preset_step(struct device_context *ctx, bool next)
+{
+    int active = has_get_active_preset(ctx->device_id);
+    int pos = -1;
+
+    if (active < 0) {
+        return BT_HAS_PRESET_INDEX_NONE;
+    }
+
+    uint8_t current = (uint8_t)active;
+
+    for (int i = 0; i < ctx->has_ctlr.preset_count; i++) {
+        if (ctx->has_ctlr.presets[i].index == current) {
+            pos = i;
+            break;
+        }
+    }
+
+    if (pos < 0) {
+        return BT_HAS_PRESET_INDEX_NONE;
+    }
+
+    for (int step = 1; step < ctx->has_ctlr.preset_count; step++) {
+        int count = ctx->has_ctlr.preset_count;
+        int i = next ? (pos + step) % count : (pos - step + count) % count;
+
+        if (ctx->has_ctlr.presets[i].available) {
+            return ctx->has_ctlr.presets[i].index;
+        }
+    }
+
+    return current;
+}
+
+/* Marks a preset command as waiting for the Active Preset Index notification. Armed before
+ * the write, since the notification may arrive before the write call returns. */
+static void has_preset_cmd_arm(uint8_t device_id, uint8_t target)
+{
+    preset_cmd_target[device_id] = target;
+    preset_cmd_pending[device_id] = true;
+}
+
+/* Drops the cached preset list of one ear and queues a read of it */
+static void has_presets_invalidate(struct device_context *ctx)
+{
+    LOG_INF("Preset list changed, reading it again [DEVICE ID %d]", ctx->device_id);
+    has_settings_clear_presets(&ctx->info.addr);
+    ctx->has_ctlr.presets_read = false;
+    ble_cmd_has_read_presets(ctx->device_id, false);
+}
+
+/* SIRK of a connected ear, from this link's CSIP discovery or else from its bond */
+static bool has_device_sirk(struct device_context *ctx, uint8_t *sirk_out)
+{
+    struct bonded_device_entry entry;
+
+    if (csip_get_sirk(ctx->device_id, sirk_out, NULL)) {
+        return true;
+    }
+
+    if (!devices_manager_find_bonded_entry_by_addr(&ctx->info.addr, &entry) || !entry.has_sirk) {
+        return false;
+    }
+
+    memcpy(sirk_out, entry.sirk, CSIP_SIRK_SIZE);
+    return true;
+}
+
+/* True if both connected ears belong to the same coordinated set and share their presets */
+static bool has_devices_in_same_set(struct device_context *ctx, struct device_context *other)
+{
+    uint8_t sirk[CSIP_SIRK_SIZE];
+    uint8_t other_sirk[CSIP_SIRK_SIZE];
+
+    if ((ctx->has_ctlr.features | other->has_ctlr.features) & HAS_FEAT_INDEPENDENT_PRESETS) {
+        /* Each ear has its own preset records */
+        return false;
+    }
+
+    if (!has_device_sirk(ctx, sirk) || !has_device_sirk(other, other_sirk)) {
+        return false;
+    }
+
+    return memcmp(sirk, other_sirk, CSIP_SIRK_SIZE) == 0;
+}
+
+/**
+ * @brief Drop the cached preset list once a Preset Changed indication sequence ends
+ *
+ * The presets of a binaural set are shared unless the ears report Independent Presets, so
+ * the list of the other connected ear in the same set is dropped as well, even if that ear
+ * does not indicate the change itself.
+ */
+static void has_presets_changed(struct bt_has *has, bool is_last)
+{
+    struct device_context *ctx = get_device_context_by_has(has);
+
+    if (!ctx) {
+        LOG_ERR("Preset changed callback from unknown connection");
+        return;
+    }
+
+    if (!is_last) {
+        return;
+    }
+
+    has_presets_invalidate(ctx);
+
+    uint8_t other_id = ctx->device_id ? 0 : 1;
+    struct device_context *other = devices_manager_get_device_context_by_id(other_id);
+
+    if (!other || !other->conn || !other->info.has_discovered) {
+        return;
+    }
+
+    /* Already dropped, its read is queued or in flight */
+    if (!other->has_ctlr.presets_read) {
+        return;
+    }
+
+    if (has_devices_in_same_set(ctx, other)) {
+        has_presets_invalidate(other);
+    }
+}
+
+/**
+ * @brief Preset Changed callback - a preset record was added or renamed
+ */
+static void has_preset_update_cb(struct bt_has *has, uint8_t index_prev,
+                                 const struct bt_has_preset_record *record, bool is_last)
+{
+    has_presets_changed(has, is_last);
+}
+
+/**
+ * @brief Preset Changed callback - a preset record was deleted
+ */
+static void has_preset_deleted_cb(struct bt_has *has, uint8_t index, bool is_last)
+{
+    has_presets_changed(has, is_last);
+}
+
+/**
+ * @brief Preset Changed callback - a preset became available or unavailable
+ */
+static void has_preset_availability_cb(struct bt_has *has, uint8_t index, bool available,
+                                       bool is_last)
+{
+    has_presets_changed(has, is_last);
 }
 
 /**
@@ -263,8 +432,8 @@ int has_cmd_discover(uint8_t device_id)
     if (load_err == 0) {
         LOG_INF("Found cached HAS data, attempting to restore");
         LOG_INF("Cached features: 0x%02X", cached_data.features);
-        LOG_DBG("  Hearing aid type: %u", cached_data.features & 0x03);
-        LOG_DBG("  Preset sync support: %s", (cached_data.features & 0x04) ? "yes" : "no");
+        LOG_DBG("  Hearing aid type: %u", cached_data.features & HAS_FEAT_HEARING_AID_TYPE_MASK);
+        LOG_DBG("  Preset sync support: %s", (cached_data.features & HAS_FEAT_PRESET_SYNC_SUPP) ? "yes" : "no");
 
         /* Inject cached handles into HAS client - this allocates the client instance */
         int inject_err = bt_has_client_set_handles(ctx->conn, &cached_data.handles);
@@ -276,6 +445,14 @@ int has_cmd_discover(uint8_t device_id)
         } else {
             LOG_INF("Cached handles restored successfully");
             handles_from_cache[device_id] = true;
+
+            /* Discovery from cached handles does not read the features again */
+            inject_err = bt_has_client_set_features(ctx->conn, cached_data.features);
+            if (inject_err != 0) {
+                LOG_WRN("Failed to inject cached features (err %d)", inject_err);
+            } else {
+                ctx->has_ctlr.features = cached_data.features;
+            }
         }
     } else {
         LOG_DBG("No cached HAS data found (err %d), performing full discovery", load_err);
@@ -289,15 +466,25 @@ int has_cmd_discover(uint8_t device_id)
 /**
  * @brief Command: Read all presets
  */
-int has_cmd_read_presets(uint8_t device_id)
+int has_cmd_read_presets(uint8_t device_id, struct ble_cmd *cmd)
 {
     struct device_context *ctx = devices_manager_get_device_context_by_id(device_id);
 
+    preset_read_cmd[device_id] = cmd;
+
     if (!ctx || !ctx->info.has_discovered) {
         LOG_ERR("HAS not discovered [DEVICE ID %d]", device_id);
         return -ENOENT;
     }
 
+    if (ctx->has_ctlr.presets_read) {
+        /* Loaded from the cache at discovery, nothing to read */
+        LOG_DBG("Presets already known (%u) [DEVICE ID %d]", ctx->has_ctlr.preset_count, ctx->device_id);
+        app_controller_notify_has_presets_read(ctx->device_id, 0);
+        ble_cmd_complete_cmd(ctx->device_id, preset_read_cmd[ctx->device_id], 0);
+        return 0;
+    }
+
     LOG_DBG("Reading presets [DEVICE ID %d]", ctx->device_id);
 
     // Reset preset storage
@@ -339,10 +526,21 @@ int has_cmd_set_active_preset(uint8_t device_id, uint8_t index)
         return -EINVAL;
     }
 
+    if (has_get_active_preset(device_id) == index) {
+        /* Already reported active, no write needed */
+        LOG_DBG("Preset %u already active [DEVICE ID %d]", index, ctx->device_id);
+        ble_cmd_complete(device_id, 0);
+        return 0;
+    }
+
     LOG_DBG("Setting active preset to %u [DEVICE ID %d]", index, ctx->device_id);
-    /* Use sync=false to avoid EOPNOTSUPP error when features aren't populated.
-     * The hearing aid will handle synchronization automatically. */
-    return bt_has_client_preset_set(ctx->has_ctlr.has, index, false);
+    /* With preset sync the hearing aid relays the change to the other ear */
+    has_preset_cmd_arm(device_id, index);
+    int err = bt_has_client_preset_set(ctx->has_ctlr.has, index, has_preset_sync_supported(device_id));
+    if (err) {
+        preset_cmd_pending[device_id] = false;
+    }
+    return err;
 }
 
 /**
@@ -365,10 +563,22 @@ int has_cmd_next_preset(uint8_t device_id)
         return -ENOENT;
     }
 
+    uint8_t target = has_preset_step(ctx, true);
+    if (target != BT_HAS_PRESET_INDEX_NONE && has_get_active_preset(device_id) == target) {
+        /* No other preset is available, the write would not change the active one */
+        LOG_DBG("No other preset available [DEVICE ID %d]", device_id);
+        ble_cmd_complete(device_id, 0);
+        return 0;
+    }
+
     LOG_DBG("Activating next preset [DEVICE ID %d]", device_id);
-    /* Use sync=false to avoid EOPNOTSUPP error when features aren't populated.
-     * The hearing aid will handle synchronization automatically. */
-    return bt_has_client_preset_next(ctx->has_ctlr.has, false);
+    /* With preset sync the hearing aid relays the change to the other ear */
+    has_preset_cmd_arm(device_id, target);
+    int err = bt_has_client_preset_next(ctx->has_ctlr.has, has_preset_sync_supported(device_id));
+    if (err) {
+        preset_cmd_pending[device_id] = false;
+    }
+    return err;
 }
 
 /**
@@ -388,10 +598,22 @@ int has_cmd_prev_preset(uint8_t device_id)
         return -ENOENT;
     }
 
+    uint8_t target = has_preset_step(ctx, false);
+    if (target != BT_HAS_PRESET_INDEX_NONE && has_get_active_preset(device_id) == target) {
+        /* No other preset is available, the write would not change the active one */
+        LOG_DBG("No other preset available [DEVICE ID %d]", device_id);
+        ble_cmd_complete(device_id, 0);
+        return 0;
+    }
+
     LOG_DBG("Activating previous preset [DEVICE ID %d]", device_id);
-    /* Use sync=false to avoid EOPNOTSUPP error when features aren't populated.
-     * The hearing aid will handle synchronization automatically. */
-    return bt_has_client_preset_prev(ctx->has_ctlr.has, false);
+    /* With preset sync the hearing aid relays the change to the other ear */
+    has_preset_cmd_arm(device_id, target);
+    int err = bt_has_client_preset_prev(ctx->has_ctlr.has, has_preset_sync_supported(device_id));
+    if (err) {
+        preset_cmd_pending[device_id] = false;
+    }
+    return err;
 }
 
 /**
@@ -428,11 +650,32 @@ int has_get_active_preset(uint8_t device_id)
         return -ENOENT;
     }
 
-    if (ctx->has_ctlr.active_preset_index == BT_HAS_PRESET_INDEX_NONE) {
-        return -1;
+    if (ctx->has_ctlr.active_preset_index != BT_HAS_PRESET_INDEX_NONE) {
+        return ctx->has_ctlr.active_preset_index;
+    }
+
+    /* An ear that has not reported yet follows the other one when presets are synchronized */
+    if (binaural_active_index != BT_HAS_PRESET_INDEX_NONE && has_preset_sync_supported(device_id)) {
+        return binaural_active_index;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Check whether preset operations are synchronized across the binaural set
+ */
+bool has_preset_sync_supported(uint8_t device_id)
+{
+    struct device_context *ctx = devices_manager_get_device_context_by_id(device_id);
+    if (!ctx || !ctx->info.has_discovered) {
+        return false;
     }
 
-    return ctx->has_ctlr.active_preset_index;
+    uint8_t features = ctx->has_ctlr.features;
+
+    return (features & HAS_FEAT_HEARING_AID_TYPE_MASK) == BT_HAS_HEARING_AID_TYPE_BINAURAL &&
+           (features & HAS_FEAT_PRESET_SYNC_SUPP);
 }
 
 /**
@@ -469,20 +712,19 @@ void has_controller_reset(uint8_t device_id)
     ctx->has_ctlr.preset_count = 0;
     ctx->has_ctlr.has = NULL;
     handles_from_cache[device_id] = false;
+    preset_cmd_pending[device_id] = false;
     LOG_DBG("HAS controller state reset [DEVICE ID %d]", ctx->device_id);
 }
 
-struct device_context *get_device_context_by_has(struct bt_has *has)
+static struct device_context *get_device_context_by_has(struct bt_has *has)
 {
-    struct device_context *ctx = &device_ctx[0];
-    
-    if (ctx->has_ctlr.has == has) {
-        return ctx;
-    }
-    ctx = &device_ctx[1];
-    if (ctx->has_ctlr.has == has) {
-        return ctx;
+    for (uint8_t i = 0; i < CONFIG_BT_MAX_CONN; i++) {
+        struct device_context *ctx = devices_manager_get_device_context_by_id(i);
+
+        if (ctx && ctx->has_ctlr.has == has) {
+            return ctx;
+        }
     }
 
     return NULL;
-}
\ No newline at end of file
+}
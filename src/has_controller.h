@@ -8,7 +8,10 @@
 #include <zephyr/bluetooth/audio/has.h>
 #include <zephyr/logging/log.h>
 
-extern bool presets_loaded;
+/* Hearing Aid Features bits, see the HAS specification */
+#define HAS_FEAT_HEARING_AID_TYPE_MASK 0x03
+#define HAS_FEAT_PRESET_SYNC_SUPP      0x04
+#define HAS_FEAT_INDEPENDENT_PRESETS   0x08
 
 /**
  * @brief Initialize HAS controller
@@ -26,10 +29,14 @@ int has_cmd_discover(uint8_t device_id);
 
 /**
  * @brief Read all presets from the hearing aid
+ *
+ * Completes without reading when the preset list was loaded from the cache, which only
+ * happens until the hearing aid reports a change to it.
  * 
+ * @param cmd Command to complete once the presets are known
  * @return 0 on success, negative error code on failure
  */
-int has_cmd_read_presets(uint8_t device_id);
+int has_cmd_read_presets(uint8_t device_id, struct ble_cmd *cmd);
 
 /**
  * @brief Set active preset by index
@@ -64,11 +71,25 @@ int has_get_preset_info(uint8_t device_id,uint8_t index, struct has_preset_info
 
 /**
  * @brief Get the currently active preset index
- * 
+ *
+ * Kept current by Active Preset Index notifications, so changes made on the hearing aid
+ * or by the phone are included. An ear that has not reported yet takes the index of the
+ * other ear when presets are synchronized.
+ *
  * @return Active preset index, or -1 if none active
  */
 int has_get_active_preset(uint8_t device_id);
 
+/**
+ * @brief Check whether preset operations are synchronized across the binaural set
+ *
+ * A binaural hearing aid with preset synchronization relays a preset change to the other
+ * ear, so preset commands only have to be sent to one of them.
+ *
+ * @return true if the hearing aid supports synchronized preset operations
+ */
+bool has_preset_sync_supported(uint8_t device_id);
+
 /**
  * @brief Reset HAS controller state
  */
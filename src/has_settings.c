@@ -1,16 +1,54 @@
 /**
  * @file has_settings.c
- * @brief HAS handle caching in NVS settings
+ * @brief HAS handle caching in the GATT cache record and preset list caching per set
  */
 
 #include "has_settings.h"
+#include "has_controller.h"
+#include "gatt_cache.h"
+#include "devices_manager.h"
+#include "retained_state.h"
 
 #include <zephyr/settings/settings.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/crc.h>
+#include <stddef.h>
 #include <string.h>
 
 LOG_MODULE_REGISTER(has_settings, LOG_LEVEL_DBG);
 
+#define HAS_PRESET_KEY_LEN 64
+
+/**
+ * @brief Preset list as stored in NVS
+ *
+ * The CRC covers everything before it. Records are always zeroed before they are filled
+ * in, so the padding is part of the CRC too.
+ */
+struct has_preset_record {
+	uint8_t version;
+	uint8_t count;
+	struct has_preset_info presets[HAS_MAX_PRESETS];
+	uint32_t crc;
+};
+
+/* RAM copy of the preset lists, at most one per bonded device, kept through System OFF */
+struct has_preset_entry {
+	bool loaded;
+	bool valid;
+	char key[HAS_PRESET_KEY_LEN];
+	struct has_preset_record record;
+};
+
+static __noinit struct has_preset_entry preset_entries[CONFIG_BT_MAX_PAIRED];
+static __noinit struct retained_seal preset_seal;
+static bool presets_restored;
+/* Set once the settings pass at boot put every preset list in RAM */
+static bool presets_preloaded;
+static bool presets_preload_incomplete;
+static uint8_t next_preset_evict;
+static K_MUTEX_DEFINE(preset_mutex);
+
 /**
  * @brief Store HAS handles and features to NVS
  */
@@ -25,24 +63,20 @@ int has_settings_store_handles(const bt_addr_le_t *addr,
 	char addr_str[BT_ADDR_LE_STR_LEN];
 	bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
 
-	/* Create settings key: "harc/device/<addr>/has_cache" */
-	char key[64];
-	snprintk(key, sizeof(key), "harc/device/%s/has_cache", addr_str);
-
 	/* Pack handles and features into cached_data structure */
 	struct has_cached_data cached_data = {
 		.handles = *handles,
 		.features = features,
 	};
 
-	/* Store cached data as binary blob */
-	int err = settings_save_one(key, &cached_data, sizeof(cached_data));
+	/* Store cached data in the device's GATT cache record */
+	int err = gatt_cache_update(addr, GATT_CACHE_HAS, &cached_data, sizeof(cached_data));
 	if (err) {
 		LOG_ERR("Failed to store HAS cache for %s (err %d)", addr_str, err);
 		return err;
 	}
 
-	LOG_INF("Stored HAS cache for %s at %s", addr_str, key);
+	LOG_INF("Stored HAS cache for %s", addr_str);
 	LOG_INF("  features: %u (ccc: %u), features_byte: 0x%02X",
 	        handles->features_handle, handles->features_ccc_handle, features);
 	LOG_INF("  control_point: %u (ccc: %u)", handles->control_point_handle, handles->control_point_ccc_handle);
@@ -50,57 +84,6 @@ int has_settings_store_handles(const bt_addr_le_t *addr,
 	return 0;
 }
 
-/* Context for settings load callback */
-struct has_load_context {
-	struct has_cached_data *cached_data;
-	bool found;
-};
-
-/* Settings load callback for HAS cache */
-static int has_settings_load_cb(const char *key, size_t len, settings_read_cb read_cb,
-                                 void *cb_arg, void *param)
-{
-	struct has_load_context *ctx = (struct has_load_context *)param;
-	const char *name;
-
-	if (!key) {
-		return 0;
-	}
-
-	/* Extract the leaf name from the key (after last '/') */
-	name = strrchr(key, '/');
-	if (name) {
-		name++; /* Skip the '/' */
-	} else {
-		name = key;
-	}
-
-	/* Try new format first (has_cache with features) */
-	if (strcmp(name, "has_cache") == 0) {
-		if (len == sizeof(struct has_cached_data)) {
-			read_cb(cb_arg, ctx->cached_data, sizeof(struct has_cached_data));
-			ctx->found = true;
-		} else {
-			LOG_WRN("Invalid HAS cache size: %zu (expected %zu)",
-			        len, sizeof(struct has_cached_data));
-		}
-	}
-	/* Fallback: try old format (has_handles without features) for backward compatibility */
-	else if (strcmp(name, "has_handles") == 0) {
-		if (len == sizeof(struct bt_has_handles)) {
-			read_cb(cb_arg, &ctx->cached_data->handles, sizeof(struct bt_has_handles));
-			ctx->cached_data->features = 0; /* Default to no features */
-			ctx->found = true;
-			LOG_INF("Loaded legacy HAS handles (no features cached)");
-		} else {
-			LOG_WRN("Invalid HAS handles size: %zu (expected %zu)",
-			        len, sizeof(struct bt_has_handles));
-		}
-	}
-
-	return 0;
-}
-
 /**
  * @brief Load HAS handles and features from NVS
  */
@@ -114,27 +97,10 @@ int has_settings_load_handles(const bt_addr_le_t *addr,
 	char addr_str[BT_ADDR_LE_STR_LEN];
 	bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
 
-	/* Create settings key base for this device */
-	char key_base[64];
-	snprintk(key_base, sizeof(key_base), "harc/device/%s", addr_str);
-	LOG_DBG("Loading HAS cache for %s at %s", addr_str, key_base);
-
-	/* Set up context for callback */
-	struct has_load_context ctx = {
-		.cached_data = cached_data,
-		.found = false,
-	};
-
-	/* Load settings for this device */
-	int err = settings_load_subtree_direct(key_base, has_settings_load_cb, &ctx);
+	int err = gatt_cache_lookup(addr, GATT_CACHE_HAS, cached_data, sizeof(*cached_data));
 	if (err) {
-		LOG_DBG("Failed to load settings for %s (err %d)", addr_str, err);
-		return -ENOENT;
-	}
-
-	if (!ctx.found) {
 		LOG_DBG("HAS cache not found for %s", addr_str);
-		return -ENOENT;
+		return err;
 	}
 
 	LOG_INF("Loaded HAS cache for %s", addr_str);
@@ -160,18 +126,8 @@ int has_settings_clear_handles(const bt_addr_le_t *addr)
 	char addr_str[BT_ADDR_LE_STR_LEN];
 	bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
 
-	/* Delete new format cache */
-	char key_cache[64];
-	snprintk(key_cache, sizeof(key_cache), "harc/device/%s/has_cache", addr_str);
-	int err = settings_delete(key_cache);
-
-	/* Also delete old format for backward compatibility */
-	char key_handles[64];
-	snprintk(key_handles, sizeof(key_handles), "harc/device/%s/has_handles", addr_str);
-	int err2 = settings_delete(key_handles);
-
-	/* Report error only if both deletions failed */
-	if (err && err2) {
+	int err = gatt_cache_invalidate(addr, BIT(GATT_CACHE_HAS));
+	if (err) {
 		LOG_ERR("Failed to clear HAS cache for %s (err %d)", addr_str, err);
 		return err;
 	}
@@ -179,3 +135,299 @@ int has_settings_clear_handles(const bt_addr_le_t *addr)
 	LOG_INF("Cleared HAS cache for %s", addr_str);
 	return 0;
 }
+
+static uint32_t has_preset_record_crc(const struct has_preset_record *record)
+{
+	return crc32_ieee((const uint8_t *)record, offsetof(struct has_preset_record, crc));
+}
+
+/* Builds the key of the preset list shared by the set the device belongs to. Ears with
+ * Independent Presets, or whose features are not known, keep a list of their own. */
+static void has_preset_key(const bt_addr_le_t *addr, char *key, size_t size)
+{
+	struct bonded_device_entry entry;
+	struct has_cached_data has_data;
+
+	if (gatt_cache_lookup(addr, GATT_CACHE_HAS, &has_data, sizeof(has_data)) == 0 &&
+	    !(has_data.features & HAS_FEAT_INDEPENDENT_PRESETS) &&
+	    devices_manager_find_bonded_entry_by_addr(addr, &entry) && entry.is_set_member &&
+	    entry.has_sirk) {
+		/* The SIRK itself is secret, only a digest of it ends up in the key */
+		snprintk(key, size, "harc/set/%08x/presets", crc32_ieee(entry.sirk, CSIP_SIRK_SIZE));
+		return;
+	}
+
+	char addr_str[BT_ADDR_LE_STR_LEN];
+	bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
+	snprintk(key, size, "harc/device/%s/presets", addr_str);
+}
+
+/* Settings load callback for the preset record */
+static int has_preset_load_cb(const char *key, size_t len, settings_read_cb read_cb,
+			      void *cb_arg, void *param)
+{
+	struct has_preset_entry *entry = (struct has_preset_entry *)param;
+
+	if (key) {
+		/* Only the record itself, not keys below it */
+		return 0;
+	}
+
+	if (len != sizeof(entry->record)) {
+		LOG_WRN("Invalid preset record size: %zu (expected %zu)", len,
+			sizeof(entry->record));
+		return 0;
+	}
+
+	read_cb(cb_arg, &entry->record, sizeof(entry->record));
+	if (entry->record.version != HAS_PRESET_RECORD_VERSION) {
+		LOG_WRN("Discarding preset record version %u", entry->record.version);
+	} else if (entry->record.crc != has_preset_record_crc(&entry->record) ||
+		   entry->record.count > HAS_MAX_PRESETS) {
+		LOG_WRN("Discarding preset record with bad CRC");
+	} else {
+		entry->valid = true;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Take over the RAM entries kept through System OFF, or start without any
+ *
+ * Must be called with preset_mutex held.
+ */
+static void has_preset_restore(void)
+{
+	if (!presets_restored) {
+		retained_state_restore("Preset lists", &preset_seal, preset_entries,
+				       sizeof(preset_entries));
+		presets_restored = true;
+	}
+}
+
+/**
+ * @brief Take a preset list seen by the settings pass at boot into RAM
+ */
+int has_settings_preload_presets(const char *key, size_t len, settings_read_cb read_cb,
+                                 void *cb_arg)
+{
+	struct has_preset_entry *entry = NULL;
+
+	if (strlen(key) >= HAS_PRESET_KEY_LEN) {
+		return 0;
+	}
+
+	k_mutex_lock(&preset_mutex, K_FOREVER);
+
+	has_preset_restore();
+
+	for (size_t i = 0; i < ARRAY_SIZE(preset_entries); i++) {
+		if (preset_entries[i].loaded && strcmp(preset_entries[i].key, key) == 0) {
+			/* Kept through System OFF */
+			k_mutex_unlock(&preset_mutex);
+			return 0;
+		}
+		if (!entry && !preset_entries[i].loaded) {
+			entry = &preset_entries[i];
+		}
+	}
+
+	if (!entry) {
+		LOG_WRN("No RAM entry left for the preset list at %s", key);
+		presets_preload_incomplete = true;
+		k_mutex_unlock(&preset_mutex);
+		return 0;
+	}
+
+	memset(entry, 0, sizeof(*entry));
+	has_preset_load_cb(NULL, len, read_cb, cb_arg, entry);
+	if (entry->valid) {
+		strcpy(entry->key, key);
+		entry->loaded = true;
+		LOG_DBG("Preloaded %u presets from %s", entry->record.count, key);
+	} else {
+		memset(entry, 0, sizeof(*entry));
+	}
+
+	k_mutex_unlock(&preset_mutex);
+	return 0;
+}
+
+/* Settings handler for "harc/set", the lists of devices outside a set come via gatt_cache */
+static int has_settings_set(const char *name, size_t len, settings_read_cb read_cb,
+			    void *cb_arg)
+{
+	char key[HAS_PRESET_KEY_LEN];
+	const char *leaf;
+
+	if (!name || settings_name_next(name, &leaf) <= 0 || !leaf ||
+	    strcmp(leaf, "presets") != 0) {
+		LOG_WRN("Ignoring settings key harc/set/%s", name ? name : "");
+		return 0;
+	}
+
+	snprintk(key, sizeof(key), "harc/set/%s", name);
+	return has_settings_preload_presets(key, len, read_cb, cb_arg);
+}
+
+static int has_settings_commit(void)
+{
+	k_mutex_lock(&preset_mutex, K_FOREVER);
+	has_preset_restore();
+	presets_preloaded = !presets_preload_incomplete;
+	k_mutex_unlock(&preset_mutex);
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(has_settings, "harc/set", NULL, has_settings_set,
+			       has_settings_commit, NULL);
+
+/**
+ * @brief Find the RAM entry of a preset list, reading it from NVS on first use
+ *
+ * After the settings pass at boot the entries already hold every list and NVS is not read.
+ *
+ * Must be called with preset_mutex held.
+ */
+static struct has_preset_entry *has_preset_entry_get(const bt_addr_le_t *addr)
+{
+	struct has_preset_entry *entry = NULL;
+	char key[HAS_PRESET_KEY_LEN];
+
+	has_preset_restore();
+
+	has_preset_key(addr, key, sizeof(key));
+
+	for (size_t i = 0; i < ARRAY_SIZE(preset_entries); i++) {
+		if (preset_entries[i].loaded && strcmp(preset_entries[i].key, key) == 0) {
+			return &preset_entries[i];
+		}
+		if (!entry && !preset_entries[i].loaded) {
+			entry = &preset_entries[i];
+		}
+	}
+
+	if (!entry) {
+		entry = &preset_entries[next_preset_evict];
+		next_preset_evict = (next_preset_evict + 1) % ARRAY_SIZE(preset_entries);
+		presets_preloaded = false;
+	}
+
+	memset(entry, 0, sizeof(*entry));
+	strcpy(entry->key, key);
+
+	if (presets_preloaded) {
+		/* The settings pass saw every list, nothing is cached under this key */
+		entry->loaded = true;
+		return entry;
+	}
+
+	int err = settings_load_subtree_direct(key, has_preset_load_cb, entry);
+	if (err) {
+		LOG_DBG("Failed to load settings at %s (err %d)", key, err);
+	}
+
+	if (!entry->valid) {
+		memset(&entry->record, 0, sizeof(entry->record));
+	}
+
+	entry->loaded = true;
+	return entry;
+}
+
+/**
+ * @brief Store the preset list of a device's set to NVS
+ */
+int has_settings_store_presets(const bt_addr_le_t *addr,
+                                const struct has_preset_info *presets, uint8_t count)
+{
+	if (!addr || !presets || count > HAS_MAX_PRESETS) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&preset_mutex, K_FOREVER);
+
+	struct has_preset_entry *entry = has_preset_entry_get(addr);
+	struct has_preset_record *record = &entry->record;
+
+	memset(record, 0, sizeof(*record));
+	record->version = HAS_PRESET_RECORD_VERSION;
+	record->count = count;
+	memcpy(record->presets, presets, count * sizeof(presets[0]));
+	record->crc = has_preset_record_crc(record);
+
+	int err = settings_save_one(entry->key, record, sizeof(*record));
+	entry->valid = (err == 0);
+
+	k_mutex_unlock(&preset_mutex);
+
+	if (err) {
+		LOG_ERR("Failed to store %u presets at %s (err %d)", count, entry->key, err);
+		return err;
+	}
+
+	LOG_INF("Stored %u presets at %s", count, entry->key);
+	return 0;
+}
+
+/**
+ * @brief Load the preset list of a device's set from NVS
+ */
+int has_settings_load_presets(const bt_addr_le_t *addr,
+                               struct has_preset_info *presets, uint8_t *count)
+{
+	if (!addr || !presets || !count) {
+		return -EINVAL;
+	}
+
+	int err = -ENOENT;
+
+	k_mutex_lock(&preset_mutex, K_FOREVER);
+
+	struct has_preset_entry *entry = has_preset_entry_get(addr);
+
+	if (entry->valid) {
+		memcpy(presets, entry->record.presets, sizeof(entry->record.presets));
+		*count = entry->record.count;
+		LOG_INF("Loaded %u presets from %s", *count, entry->key);
+		err = 0;
+	} else {
+		LOG_DBG("No presets cached at %s", entry->key);
+	}
+
+	k_mutex_unlock(&preset_mutex);
+	return err;
+}
+
+/**
+ * @brief Clear the preset list of a device's set from NVS
+ */
+int has_settings_clear_presets(const bt_addr_le_t *addr)
+{
+	if (!addr) {
+		return -EINVAL;
+	}
+
+	int err = 0;
+
+	k_mutex_lock(&preset_mutex, K_FOREVER);
+
+	struct has_preset_entry *entry = has_preset_entry_get(addr);
+
+	if (entry->valid) {
+		entry->valid = false;
+		memset(&entry->record, 0, sizeof(entry->record));
+		err = settings_delete(entry->key);
+	}
+
+	k_mutex_unlock(&preset_mutex);
+
+	if (err) {
+		LOG_ERR("Failed to clear presets at %s (err %d)", entry->key, err);
+		return err;
+	}
+
+	LOG_INF("Cleared presets at %s", entry->key);
+	return 0;
+}
@@ -1,6 +1,6 @@
 /**
  * @file has_settings.h
- * @brief HAS handle caching in NVS settings
+ * @brief HAS handle caching in the GATT cache record and preset list caching per set
  */
 
 #ifndef HAS_SETTINGS_H_
@@ -8,6 +8,11 @@
 
 #include <zephyr/bluetooth/bluetooth.h>
 #include <zephyr/bluetooth/audio/has.h>
+#include <zephyr/settings/settings.h>
+#include "ble_manager.h"
+
+/* Bumped whenever the layout of the preset record changes, older records are discarded */
+#define HAS_PRESET_RECORD_VERSION 1
 
 /**
  * @brief Extended HAS cache structure including handles and features
@@ -47,4 +52,55 @@ int has_settings_load_handles(const bt_addr_le_t *addr,
  */
 int has_settings_clear_handles(const bt_addr_le_t *addr);
 
+/**
+ * @brief Store the preset list of a device's set to NVS
+ *
+ * The members of a binaural set share one preset list, so it is stored once under
+ * "harc/set/<id>/presets", with the id derived from the SIRK. Devices outside a set, and
+ * devices that report Independent Presets in their HAS features, use
+ * "harc/device/<addr>/presets".
+ *
+ * @param addr Bluetooth address of the device the presets were read from
+ * @param presets Preset list to store
+ * @param count Number of entries in @p presets
+ * @return 0 on success, negative errno on failure
+ */
+int has_settings_store_presets(const bt_addr_le_t *addr,
+                                const struct has_preset_info *presets, uint8_t count);
+
+/**
+ * @brief Load the preset list of a device's set from NVS
+ *
+ * The lists are read into RAM by the settings pass at boot and served from RAM afterwards.
+ *
+ * @param addr Bluetooth address of the device
+ * @param presets Buffer for HAS_MAX_PRESETS entries
+ * @param count Number of entries loaded
+ * @return 0 on success, -ENOENT if not found, negative errno on failure
+ */
+int has_settings_load_presets(const bt_addr_le_t *addr,
+                               struct has_preset_info *presets, uint8_t *count);
+
+/**
+ * @brief Take a preset list seen by the settings pass at boot into RAM
+ *
+ * Called by the settings handlers for keys ending in "/presets".
+ *
+ * @param key Full settings key of the list
+ * @param len Size of the stored value
+ * @param read_cb Settings read callback
+ * @param cb_arg Argument for @p read_cb
+ * @return 0, invalid lists are skipped
+ */
+int has_settings_preload_presets(const char *key, size_t len, settings_read_cb read_cb,
+                                 void *cb_arg);
+
+/**
+ * @brief Clear the preset list of a device's set from NVS
+ *
+ * @param addr Bluetooth address of the device
+ * @return 0 on success, negative errno on failure
+ */
+int has_settings_clear_presets(const bt_addr_le_t *addr);
+
 #endif /* HAS_SETTINGS_H_ */
@@ -0,0 +1,615 @@
+#include "link_manager.h"
+#include "devices_manager.h"
+#include <zephyr/bluetooth/hci.h>
+#include <zephyr/bluetooth/hci_vs.h>
+#include <zephyr/sys/byteorder.h>
+
+LOG_MODULE_REGISTER(link_manager, LOG_LEVEL_INF);
+
+enum link_mode {
+	LINK_MODE_ACTIVE,
+	LINK_MODE_SUBRATED,
+	LINK_MODE_SLOW,
+	LINK_MODE_COUNT,
+};
+
+static const char *const link_mode_names[LINK_MODE_COUNT] = {"active", "subrated", "slow"};
+
+/* nRF52832 TX power levels and radio TX current with the DC/DC regulator */
+static const struct {
+	int8_t dbm;
+	uint16_t current_ua;
+} tx_power_levels[] = {
+	{-40, 2700}, {-20, 3200}, {-16, 3300}, {-12, 3500}, {-8, 3800},
+	{-4, 4200},  {0, 5300},   {4, 7500},
+};
+
+/* Index of the controller default TX power (0 dBm), used by every new connection */
+#define TX_POWER_DEFAULT_IDX 6
+#define TX_POWER_MAX_IDX (ARRAY_SIZE(tx_power_levels) - 1)
+
+/* Link state, indexed by bt_conn_index() so it is valid before the device context is set */
+struct link_state {
+	enum link_mode mode;
+	bool idle; /* Idle mode requested */
+	bool subrating_unsupported;
+	uint16_t interval; /* Connection interval in 1.25 ms units */
+	uint16_t factor; /* Subrate factor, 1 when not subrated */
+	int64_t mode_start;
+	int64_t mode_time_ms[LINK_MODE_COUNT];
+	uint64_t events; /* Estimated connection events used by the link */
+	uint8_t txp_idx; /* Index into tx_power_levels */
+	int8_t rssi; /* Latest RSSI */
+	int16_t rssi_avg; /* Smoothed RSSI in 1/16 dBm */
+	uint8_t rssi_samples;
+	int64_t txp_saved_pc; /* Radio charge saved against the default TX power, in pC */
+	int64_t connected_time;
+};
+
+static struct link_state links[CONFIG_BT_MAX_CONN];
+
+/* Per device counters, indexed by device ID and kept across reconnections */
+static struct {
+	uint32_t cmd_timeouts;
+	uint32_t cmd_retries;
+	uint32_t cmd_errors;
+	uint32_t short_mtu_reads;
+	uint32_t disconnects;
+	uint8_t last_disconnect_reason;
+} counters[CONFIG_BT_MAX_CONN];
+static struct k_spinlock counters_lock;
+static struct k_work activity_work;
+static struct k_work_delayable idle_work;
+static struct k_work_delayable slow_idle_work;
+static struct k_work_delayable txp_work;
+
+/* The state is zeroed on disconnect, or left zeroed when the connected callback bailed out */
+static uint32_t link_factor(const struct link_state *link)
+{
+	return (link->factor != 0) ? link->factor : 1U;
+}
+
+static uint32_t link_events_per_min(const struct link_state *link)
+{
+	if (link->interval == 0) {
+		return 0;
+	}
+
+	/* 60000 ms / (interval * 1.25 ms * factor) */
+	return (60000U * 4U) / (5U * link->interval * link_factor(link));
+}
+
+static void link_account(struct link_state *link)
+{
+	int64_t now = k_uptime_get();
+
+	if (link->mode_start != 0 && link->interval != 0) {
+		int64_t elapsed = now - link->mode_start;
+
+		link->mode_time_ms[link->mode] += elapsed;
+		link->events += ((uint64_t)elapsed * 4U) / (5U * link->interval * link_factor(link));
+	}
+
+	link->mode_start = now;
+}
+
+static void link_set_mode(struct bt_conn *conn, enum link_mode mode)
+{
+	struct link_state *link = &links[bt_conn_index(conn)];
+
+	link_account(link);
+	link->mode = mode;
+
+	LOG_INF("Link %d %s: interval %d.%02d ms, subrate %d, ~%d connection events/min",
+		bt_conn_index(conn), link_mode_names[mode], (link->interval * 125) / 100,
+		(link->interval * 125) % 100, link->factor, link_events_per_min(link));
+}
+
+static bool link_is_connected(struct bt_conn *conn)
+{
+	struct bt_conn_info info;
+
+	return bt_conn_get_info(conn, &info) == 0 && info.state == BT_CONN_STATE_CONNECTED;
+}
+
+static int link_request_slow(struct bt_conn *conn, bool slow)
+{
+	int err;
+
+	if (slow) {
+		err = bt_conn_le_param_update(conn,
+					      BT_LE_CONN_PARAM(LINK_IDLE_INTERVAL_MIN,
+							       LINK_IDLE_INTERVAL_MAX, 0,
+							       LINK_IDLE_TIMEOUT));
+	} else {
+		err = bt_conn_le_param_update(conn, BT_LE_CONN_PARAM_DEFAULT);
+	}
+
+	if (err) {
+		LOG_WRN("Connection parameter update failed (err %d) [LINK %d]", err,
+			bt_conn_index(conn));
+	}
+
+	return err;
+}
+
+#if defined(CONFIG_BT_SUBRATING)
+static bool link_peer_supports_subrating(struct bt_conn *conn)
+{
+	struct bt_conn_remote_info remote_info;
+
+	if (bt_conn_get_remote_info(conn, &remote_info) != 0) {
+		return false;
+	}
+
+	return BT_FEAT_LE_CONN_SUBRATING(remote_info.le.features);
+}
+
+static int link_request_subrate(struct bt_conn *conn, uint16_t factor)
+{
+	const struct bt_conn_le_subrate_param param = {
+		.subrate_min = factor,
+		.subrate_max = factor,
+		.max_latency = 0,
+		.continuation_number = (factor > 1) ? LINK_SUBRATE_CONTINUATION : 0,
+		.supervision_timeout = LINK_SUBRATE_TIMEOUT,
+	};
+
+	int err = bt_conn_le_subrate_request(conn, &param);
+	if (err) {
+		LOG_WRN("Subrate request failed (err %d) [LINK %d]", err, bt_conn_index(conn));
+	}
+
+	return err;
+}
+
+static void link_subrate_changed(struct bt_conn *conn,
+				 const struct bt_conn_le_subrate_changed *params)
+{
+	struct link_state *link = &links[bt_conn_index(conn)];
+
+	if (params->status != BT_HCI_ERR_SUCCESS) {
+		LOG_WRN("Subrating rejected (status 0x%02X), using connection parameters [LINK %d]",
+			params->status, bt_conn_index(conn));
+		link->subrating_unsupported = true;
+		link->idle = false;
+		if (LINK_IDLE_SLOW_FALLBACK) {
+			/* Does not move a pending fallback, it still counts from the last activity */
+			k_work_schedule(&slow_idle_work, K_MSEC(LINK_IDLE_SLOW_TIMEOUT_MS));
+		}
+		return;
+	}
+
+	link_account(link);
+	link->factor = MAX(params->factor, 1);
+	link_set_mode(conn, (params->factor > 1) ? LINK_MODE_SUBRATED : LINK_MODE_ACTIVE);
+
+	/* Activity arrived while the idle request was in flight */
+	if (!link->idle && link->mode == LINK_MODE_SUBRATED) {
+		link_request_subrate(conn, 1);
+	}
+}
+#endif /* CONFIG_BT_SUBRATING */
+
+static void link_enter_idle(struct bt_conn *conn, void *user_data)
+{
+	struct link_state *link = &links[bt_conn_index(conn)];
+
+	if (link->idle || !link_is_connected(conn)) {
+		return;
+	}
+
+#if defined(CONFIG_BT_SUBRATING)
+	if (!link->subrating_unsupported && link_peer_supports_subrating(conn)) {
+		link->idle = true;
+		if (link_request_subrate(conn, LINK_SUBRATE_IDLE_FACTOR) != 0) {
+			link->idle = false;
+		}
+	}
+#endif
+}
+
+/* Fallback for links that were not subrated, see LINK_IDLE_SLOW_FALLBACK */
+static void link_enter_slow_idle(struct bt_conn *conn, void *user_data)
+{
+	struct link_state *link = &links[bt_conn_index(conn)];
+
+	if (link->idle || !link_is_connected(conn)) {
+		return;
+	}
+
+	link->idle = true;
+	link_request_slow(conn, true);
+}
+
+static void link_exit_idle(struct bt_conn *conn, void *user_data)
+{
+	struct link_state *link = &links[bt_conn_index(conn)];
+
+	if (!link->idle || !link_is_connected(conn)) {
+		return;
+	}
+
+	link->idle = false;
+
+	switch (link->mode) {
+#if defined(CONFIG_BT_SUBRATING)
+	case LINK_MODE_SUBRATED:
+		link_request_subrate(conn, 1);
+		break;
+#endif
+	case LINK_MODE_SLOW:
+		link_request_slow(conn, false);
+		break;
+	default:
+		/* The idle request has not completed yet, undo it once it has */
+		break;
+	}
+}
+
+static void idle_work_handler(struct k_work *work)
+{
+	bt_conn_foreach(BT_CONN_TYPE_LE, link_enter_idle, NULL);
+}
+
+static void slow_idle_work_handler(struct k_work *work)
+{
+	bt_conn_foreach(BT_CONN_TYPE_LE, link_enter_slow_idle, NULL);
+}
+
+static void link_schedule_idle(void)
+{
+	k_work_reschedule(&idle_work, K_MSEC(LINK_IDLE_TIMEOUT_MS));
+	if (LINK_IDLE_SLOW_FALLBACK) {
+		k_work_reschedule(&slow_idle_work, K_MSEC(LINK_IDLE_SLOW_TIMEOUT_MS));
+	}
+}
+
+static void activity_work_handler(struct k_work *work)
+{
+	bt_conn_foreach(BT_CONN_TYPE_LE, link_exit_idle, NULL);
+	link_schedule_idle();
+}
+
+static int link_read_rssi(uint16_t handle, int8_t *rssi)
+{
+	struct bt_hci_cp_read_rssi *cp;
+	struct bt_hci_rp_read_rssi *rp;
+	struct net_buf *buf, *rsp = NULL;
+
+	buf = bt_hci_cmd_create(BT_HCI_OP_READ_RSSI, sizeof(*cp));
+	if (!buf) {
+		return -ENOBUFS;
+	}
+
+	cp = net_buf_add(buf, sizeof(*cp));
+	cp->handle = sys_cpu_to_le16(handle);
+
+	int err = bt_hci_cmd_send_sync(BT_HCI_OP_READ_RSSI, buf, &rsp);
+	if (err) {
+		return err;
+	}
+
+	rp = (void *)rsp->data;
+	*rssi = rp->rssi;
+	net_buf_unref(rsp);
+
+	return 0;
+}
+
+static int link_write_tx_power(uint16_t handle, int8_t dbm, int8_t *selected)
+{
+	struct bt_hci_cp_vs_write_tx_power_level *cp;
+	struct bt_hci_rp_vs_write_tx_power_level *rp;
+	struct net_buf *buf, *rsp = NULL;
+
+	buf = bt_hci_cmd_create(BT_HCI_OP_VS_WRITE_TX_POWER_LEVEL, sizeof(*cp));
+	if (!buf) {
+		return -ENOBUFS;
+	}
+
+	cp = net_buf_add(buf, sizeof(*cp));
+	cp->handle = sys_cpu_to_le16(handle);
+	cp->handle_type = BT_HCI_VS_LL_HANDLE_TYPE_CONN;
+	cp->tx_power_level = dbm;
+
+	int err = bt_hci_cmd_send_sync(BT_HCI_OP_VS_WRITE_TX_POWER_LEVEL, buf, &rsp);
+	if (err) {
+		return err;
+	}
+
+	rp = (void *)rsp->data;
+	*selected = rp->selected_tx_power;
+	net_buf_unref(rsp);
+
+	return 0;
+}
+
+static void link_txp_sample(struct bt_conn *conn, void *user_data)
+{
+	struct link_state *link = &links[bt_conn_index(conn)];
+	bool *any_connected = user_data;
+	uint16_t handle;
+	int8_t rssi;
+
+	if (!link_is_connected(conn)) {
+		return;
+	}
+
+	*any_connected = true;
+
+	if (bt_hci_get_conn_handle(conn, &handle) || link_read_rssi(handle, &rssi) ||
+	    rssi == BT_HCI_LE_RSSI_NOT_AVAILABLE) {
+		return;
+	}
+
+	/* Charge saved over the events since the last sample, at the current TX power */
+	uint64_t events = link->events;
+
+	link_account(link);
+	link->txp_saved_pc += (int64_t)(link->events - events) * LINK_TX_US_PER_EVENT *
+			      (tx_power_levels[TX_POWER_DEFAULT_IDX].current_ua -
+			       tx_power_levels[link->txp_idx].current_ua);
+
+	link->rssi = rssi;
+	if (link->rssi_samples == 0) {
+		link->rssi_avg = rssi * 16;
+	} else {
+		link->rssi_avg += (rssi * 16 - link->rssi_avg) / 4;
+	}
+
+	if (link->rssi_samples < LINK_TXP_MIN_SAMPLES) {
+		link->rssi_samples++;
+		return;
+	}
+
+	int path_loss = LINK_TXP_PEER_TX_DBM - link->rssi_avg / 16;
+	int margin = tx_power_levels[link->txp_idx].dbm - path_loss - LINK_TXP_PEER_SENSITIVITY_DBM;
+	uint8_t idx = link->txp_idx;
+
+	if (margin < LINK_TXP_MARGIN_CRITICAL_DB) {
+		idx = TX_POWER_MAX_IDX;
+	} else if (margin < LINK_TXP_MARGIN_LOW_DB && idx < TX_POWER_MAX_IDX) {
+		idx++;
+	} else if (idx > 0 && margin - (tx_power_levels[idx].dbm - tx_power_levels[idx - 1].dbm) >=
+				      LINK_TXP_MARGIN_LOW_DB + LINK_TXP_HYSTERESIS_DB) {
+		idx--;
+	}
+
+	if (idx == link->txp_idx) {
+		return;
+	}
+
+	int8_t selected;
+	int err = link_write_tx_power(handle, tx_power_levels[idx].dbm, &selected);
+	if (err) {
+		LOG_WRN("Failed to set TX power (err %d) [LINK %d]", err, bt_conn_index(conn));
+		return;
+	}
+
+	LOG_INF("Link %d TX power %d -> %d dBm (selected %d), path loss %d dB, margin %d dB",
+		bt_conn_index(conn), tx_power_levels[link->txp_idx].dbm, tx_power_levels[idx].dbm,
+		selected, path_loss, margin);
+	link->txp_idx = idx;
+}
+
+static void txp_work_handler(struct k_work *work)
+{
+	bool any_connected = false;
+
+	bt_conn_foreach(BT_CONN_TYPE_LE, link_txp_sample, &any_connected);
+
+	if (any_connected) {
+		k_work_reschedule(&txp_work, K_MSEC(LINK_TXP_SAMPLE_MS));
+	}
+}
+
+static void link_print_stats(uint8_t index)
+{
+	struct link_state *link = &links[index];
+	int64_t total_ms = 0;
+
+	link_account(link);
+	for (int i = 0; i < LINK_MODE_COUNT; i++) {
+		total_ms += link->mode_time_ms[i];
+	}
+
+	LOG_INF("Link %d: active %lld ms, subrated %lld ms, slow %lld ms, ~%llu connection "
+		"events (%llu/min)",
+		index, link->mode_time_ms[LINK_MODE_ACTIVE], link->mode_time_ms[LINK_MODE_SUBRATED],
+		link->mode_time_ms[LINK_MODE_SLOW], link->events,
+		total_ms ? (link->events * 60000U) / total_ms : 0);
+	LOG_INF("Link %d: TX power %d dBm, RSSI %d dBm, ~%lld nC radio charge saved this wake "
+		"cycle",
+		index, tx_power_levels[link->txp_idx].dbm, link->rssi_avg / 16,
+		link->txp_saved_pc / 1000);
+}
+
+void link_manager_print_stats(uint8_t device_id)
+{
+	struct device_context *ctx = devices_manager_get_device_context_by_id(device_id);
+
+	if (!ctx || !ctx->conn) {
+		return;
+	}
+
+	link_print_stats(bt_conn_index(ctx->conn));
+}
+
+static void link_connected(struct bt_conn *conn, uint8_t err)
+{
+	struct link_state *link = &links[bt_conn_index(conn)];
+	struct bt_conn_info info;
+
+	if (err || bt_conn_get_info(conn, &info)) {
+		return;
+	}
+
+	memset(link, 0, sizeof(*link));
+	link->interval = info.le.interval;
+	link->factor = 1;
+	link->mode_start = k_uptime_get();
+	link->connected_time = link->mode_start;
+	link->txp_idx = TX_POWER_DEFAULT_IDX;
+	link->rssi = BT_HCI_LE_RSSI_NOT_AVAILABLE;
+
+	link_schedule_idle();
+	k_work_reschedule(&txp_work, K_MSEC(LINK_TXP_SAMPLE_MS));
+}
+
+static void link_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	link_print_stats(bt_conn_index(conn));
+	memset(&links[bt_conn_index(conn)], 0, sizeof(struct link_state));
+}
+
+static void link_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency,
+			       uint16_t timeout)
+{
+	struct link_state *link = &links[bt_conn_index(conn)];
+
+	link_account(link);
+	link->interval = interval;
+
+	if (link->mode == LINK_MODE_SUBRATED) {
+		return;
+	}
+
+	link_set_mode(conn, (interval >= LINK_IDLE_INTERVAL_MIN) ? LINK_MODE_SLOW
+								 : LINK_MODE_ACTIVE);
+
+	/* Activity arrived while the idle update was in flight */
+	if (!link->idle && link->mode == LINK_MODE_SLOW) {
+		link_request_slow(conn, false);
+	}
+}
+
+BT_CONN_CB_DEFINE(link_conn_callbacks) = {
+	.connected = link_connected,
+	.disconnected = link_disconnected,
+	.le_param_updated = link_param_updated,
+#if defined(CONFIG_BT_SUBRATING)
+	.subrate_changed = link_subrate_changed,
+#endif
+};
+
+int link_manager_init(void)
+{
+	k_work_init(&activity_work, activity_work_handler);
+	k_work_init_delayable(&idle_work, idle_work_handler);
+	k_work_init_delayable(&slow_idle_work, slow_idle_work_handler);
+	k_work_init_delayable(&txp_work, txp_work_handler);
+
+	LOG_DBG("Link manager initialized");
+	return 0;
+}
+
+void link_manager_notify_activity(void)
+{
+	k_work_submit(&activity_work);
+}
+
+int link_manager_get_telemetry(uint8_t device_id, struct link_telemetry *telemetry)
+{
+	struct device_context *ctx = devices_manager_get_device_context_by_id(device_id);
+	struct bt_conn_info info;
+
+	if (!ctx || !telemetry) {
+		return -EINVAL;
+	}
+
+	memset(telemetry, 0, sizeof(*telemetry));
+	telemetry->rssi = BT_HCI_LE_RSSI_NOT_AVAILABLE;
+	telemetry->rssi_avg = BT_HCI_LE_RSSI_NOT_AVAILABLE;
+
+	k_spinlock_key_t key = k_spin_lock(&counters_lock);
+	telemetry->cmd_timeouts = counters[device_id].cmd_timeouts;
+	telemetry->cmd_retries = counters[device_id].cmd_retries;
+	telemetry->cmd_errors = counters[device_id].cmd_errors;
+	telemetry->short_mtu_reads = counters[device_id].short_mtu_reads;
+	telemetry->disconnects = counters[device_id].disconnects;
+	telemetry->last_disconnect_reason = counters[device_id].last_disconnect_reason;
+	k_spin_unlock(&counters_lock, key);
+
+	if (!ctx->conn || bt_conn_get_info(ctx->conn, &info) ||
+	    info.state != BT_CONN_STATE_CONNECTED) {
+		return 0;
+	}
+
+	struct link_state *link = &links[bt_conn_index(ctx->conn)];
+
+	telemetry->connected = true;
+	telemetry->interval = info.le.interval;
+	telemetry->latency = info.le.latency;
+	telemetry->timeout = info.le.timeout;
+#if defined(CONFIG_BT_USER_PHY_UPDATE)
+	telemetry->tx_phy = info.le.phy->tx_phy;
+	telemetry->rx_phy = info.le.phy->rx_phy;
+#endif
+	telemetry->subrate_factor = link->factor;
+	telemetry->tx_power_dbm = tx_power_levels[link->txp_idx].dbm;
+	telemetry->connected_ms = (uint32_t)(k_uptime_get() - link->connected_time);
+	if (link->rssi_samples > 0) {
+		telemetry->rssi = link->rssi;
+		telemetry->rssi_avg = link->rssi_avg / 16;
+	}
+
+	return 0;
+}
+
+void link_manager_print_telemetry(uint8_t device_id)
+{
+	struct link_telemetry t;
+
+	if (link_manager_get_telemetry(device_id, &t)) {
+		return;
+	}
+
+	if (t.connected) {
+		LOG_INF("RSSI %d (avg %d) dBm, TX %d dBm, interval %d, latency %d, timeout %d, "
+			"subrate %d, PHY %d/%d, up %u ms [DEVICE ID %d]",
+			t.rssi, t.rssi_avg, t.tx_power_dbm, t.interval, t.latency, t.timeout,
+			t.subrate_factor, t.tx_phy, t.rx_phy, t.connected_ms, device_id);
+	}
+
+	LOG_INF("Commands: %u timeouts, %u retries, %u errors, %u short MTU reads; %u "
+		"disconnects (last reason 0x%02X) [DEVICE ID %d]",
+		t.cmd_timeouts, t.cmd_retries, t.cmd_errors, t.short_mtu_reads, t.disconnects,
+		t.last_disconnect_reason, device_id);
+}
+
+void link_manager_record_cmd_timeout(uint8_t device_id)
+{
+	k_spinlock_key_t key = k_spin_lock(&counters_lock);
+	counters[device_id].cmd_timeouts++;
+	k_spin_unlock(&counters_lock, key);
+}
+
+void link_manager_record_cmd_retry(uint8_t device_id)
+{
+	k_spinlock_key_t key = k_spin_lock(&counters_lock);
+	counters[device_id].cmd_retries++;
+	k_spin_unlock(&counters_lock, key);
+}
+
+void link_manager_record_cmd_error(uint8_t device_id)
+{
+	k_spinlock_key_t key = k_spin_lock(&counters_lock);
+	counters[device_id].cmd_errors++;
+	k_spin_unlock(&counters_lock, key);
+}
+
+void link_manager_record_short_mtu(uint8_t device_id)
+{
+	k_spinlock_key_t key = k_spin_lock(&counters_lock);
+	counters[device_id].short_mtu_reads++;
+	k_spin_unlock(&counters_lock, key);
+}
+
+void link_manager_record_disconnect(uint8_t device_id, uint8_t reason)
+{
+	k_spinlock_key_t key = k_spin_lock(&counters_lock);
+	counters[device_id].disconnects++;
+	counters[device_id].last_disconnect_reason = reason;
+	k_spin_unlock(&counters_lock, key);
+}
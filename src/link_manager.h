@@ -0,0 +1,119 @@
+#ifndef LINK_MANAGER_H
+#define LINK_MANAGER_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/logging/log.h>
+
+/**
+ * @brief Idle link handling.
+ *
+ * A link with no button or GATT activity for LINK_IDLE_TIMEOUT_MS is put in idle mode.
+ * With LE Connection Subrating the link keeps its connection interval, but only every
+ * LINK_SUBRATE_IDLE_FACTOR-th event is used. Returning to the base rate takes effect
+ * on the next used event.
+ *
+ * Links that cannot be subrated stay at the default parameters unless
+ * LINK_IDLE_SLOW_FALLBACK is set. The fallback updates them to LINK_IDLE_INTERVAL_MIN..MAX
+ * after LINK_IDLE_SLOW_TIMEOUT_MS, and back to the default parameters on activity. The
+ * first button press after that goes out at the idle interval, and the update back only
+ * takes effect at least 6 idle events later (about 750 ms), so it costs button latency.
+ */
+#define LINK_IDLE_TIMEOUT_MS 3000
+#define LINK_IDLE_SLOW_FALLBACK 0
+#define LINK_IDLE_SLOW_TIMEOUT_MS 30000
+
+#define LINK_SUBRATE_IDLE_FACTOR 8
+/* Events kept at the base rate after a packet was exchanged in a subrated event */
+#define LINK_SUBRATE_CONTINUATION 1
+/* Supervision timeout in 10 ms units, covers LINK_SUBRATE_IDLE_FACTOR x 50 ms */
+#define LINK_SUBRATE_TIMEOUT 400
+
+/* Fallback idle connection parameters, in 1.25 ms units (100 - 125 ms) */
+#define LINK_IDLE_INTERVAL_MIN 80
+#define LINK_IDLE_INTERVAL_MAX 100
+#define LINK_IDLE_TIMEOUT 400
+
+/**
+ * @brief Path loss driven TX power control.
+ *
+ * Every LINK_TXP_SAMPLE_MS the controller RSSI of each link is read and smoothed. The
+ * path loss is taken as LINK_TXP_PEER_TX_DBM minus the smoothed RSSI, and the margin as
+ * our TX power minus the path loss minus LINK_TXP_PEER_SENSITIVITY_DBM. Below
+ * LINK_TXP_MARGIN_LOW_DB the TX power goes up one step, or straight to the maximum below
+ * LINK_TXP_MARGIN_CRITICAL_DB. It goes down one step only if the margin after the step
+ * stays LINK_TXP_HYSTERESIS_DB above LINK_TXP_MARGIN_LOW_DB.
+ */
+#define LINK_TXP_SAMPLE_MS 1000
+#define LINK_TXP_MIN_SAMPLES 3
+#define LINK_TXP_PEER_TX_DBM 0
+#define LINK_TXP_PEER_SENSITIVITY_DBM -90
+#define LINK_TXP_MARGIN_LOW_DB 15
+#define LINK_TXP_MARGIN_CRITICAL_DB 6
+#define LINK_TXP_HYSTERESIS_DB 6
+
+/* Radio on time per connection event for an empty packet at 1M PHY, including ramp up */
+#define LINK_TX_US_PER_EVENT 120
+
+/**
+ * @brief Snapshot of the link quality of one device.
+ *
+ * The counters are kept per device across reconnections, the link fields describe the
+ * current connection and are only valid when @p connected is set. The Zephyr LL controller
+ * does not report missed connection events, so link losses are visible through
+ * @p disconnects and @p last_disconnect_reason instead.
+ */
+struct link_telemetry {
+	bool connected;
+	int8_t rssi; /* Latest RSSI, BT_HCI_LE_RSSI_NOT_AVAILABLE until the first sample */
+	int8_t rssi_avg; /* Smoothed RSSI */
+	int8_t tx_power_dbm;
+	uint16_t interval; /* Connection interval in 1.25 ms units */
+	uint16_t latency;
+	uint16_t timeout; /* Supervision timeout in 10 ms units */
+	uint16_t subrate_factor;
+	uint8_t tx_phy;
+	uint8_t rx_phy;
+	uint32_t connected_ms;
+	uint32_t cmd_timeouts; /* BLE commands that hit the command queue safety timeout */
+	uint32_t cmd_retries; /* BLE commands re-enqueued because the server was busy */
+	uint32_t cmd_errors; /* BLE commands completed with an error */
+	uint32_t short_mtu_reads; /* Preset reads that ran with an MTU below APP_ATT_MTU_MIN */
+	uint32_t disconnects;
+	uint8_t last_disconnect_reason;
+};
+
+int link_manager_init(void);
+
+/**
+ * @brief Bring all idle links back to the base rate and restart the idle timer
+ *
+ * Safe to call from ISR context.
+ */
+void link_manager_notify_activity(void);
+
+/**
+ * @brief Log the time spent in each mode and the estimated connection events per minute
+ *
+ * @param device_id Device ID of the link
+ */
+void link_manager_print_stats(uint8_t device_id);
+
+/**
+ * @brief Take a consistent snapshot of a device's link telemetry
+ *
+ * @param device_id Device ID
+ * @param telemetry Snapshot to fill in
+ * @return 0 on success, negative error code on failure
+ */
+int link_manager_get_telemetry(uint8_t device_id, struct link_telemetry *telemetry);
+void link_manager_print_telemetry(uint8_t device_id);
+
+void link_manager_record_cmd_timeout(uint8_t device_id);
+void link_manager_record_cmd_retry(uint8_t device_id);
+void link_manager_record_cmd_error(uint8_t device_id);
+void link_manager_record_short_mtu(uint8_t device_id);
+void link_manager_record_disconnect(uint8_t device_id, uint8_t reason);
+
+#endif /* LINK_MANAGER_H */
@@ -16,14 +16,10 @@ int main(void)
     int err;
 
     if (IS_ENABLED(CONFIG_SETTINGS)) {
+        /* Loaded in one pass once Bluetooth is enabled, see bt_ready_cb() */
         err = settings_subsys_init();
         if (err) {
             LOG_ERR("Settings init failed (err %d)", err);
-        } else {
-            err = settings_load();
-            if (err) {
-                LOG_ERR("Settings load failed (err %d)", err);
-            }
         }
     }
 
@@ -4,12 +4,15 @@
 #include "button_manager.h"
 #include "display_manager.h"
 #include "app_controller.h"
+#include "link_manager.h"
+#include "retained_state.h"
 #include <hal/nrf_gpio.h>
 #include <zephyr/init.h>
 
 LOG_MODULE_REGISTER(power_manager, LOG_LEVEL_INF);
 
 uint8_t power_manager_wake_button;
+bool power_manager_woke_from_off;
 
 SYS_INIT(get_wakeup_source, PRE_KERNEL_1, 0);
 
@@ -18,6 +21,10 @@ int get_wakeup_source(void) {
     hwinfo_get_reset_cause(&reset_cause);
     power_manager_wake_button = 0;
 
+    /* The reset reasons are sticky, cleared so a later reset is not taken for a wake */
+    power_manager_woke_from_off = (reset_cause & RESET_LOW_POWER_WAKE) != 0;
+    hwinfo_clear_reset_cause();
+
     // Check which button woke us up
     if (nrf_gpio_pin_latch_get(VOLUME_UP_BTN_PIN)) {
         // Volume up pressed
@@ -75,6 +82,7 @@ void power_manager_prepare_power_off() {
 
     /**
      * Ensure the system is ready to power off:
+     * - Save the last known state for the display at the next wake.
      * - Put display to sleep.
      * - Reconfigure button interrupts to allow wake-up.
      * - Disconnect any active BLE connections.
@@ -83,6 +91,12 @@ void power_manager_prepare_power_off() {
      * - Power off.
     */
 
+    /* Before the disconnects below reset what the display shows */
+    err = display_manager_save_snapshot();
+    if (err) {
+        LOG_WRN("Failed to save display snapshot (err %d) - continuing", err);
+    }
+
     err = display_manager_sleep();
     if (err) {
         LOG_WRN("Failed to sleep display (err %d) - continuing", err);
@@ -91,6 +105,11 @@ void power_manager_prepare_power_off() {
     for (ssize_t i = 1; i <= 4; i++)
         button_manager_set_button_interrupt_mode(i, GPIO_INT_LEVEL_ACTIVE);
 
+    ble_manager_cancel_reconnect();
+
+    link_manager_print_telemetry(0);
+    link_manager_print_telemetry(1);
+
     if (ble_manager_disconnect_device(device_ctx[0].conn) == -EINVAL) {
         LOG_DBG("No active connection to disconnect for device 0");
         app_controller_notify_device_disconnected(0);
@@ -112,6 +131,9 @@ void power_manager_prepare_power_off() {
 }
 
 void power_manager_power_off() {
+    /* Last, so nothing changes the caches after they are sealed */
+    retained_state_keep_all();
+
     LOG_ERR("... powering off now."); // ERR level to ensure visibility
     while(log_data_pending()) {
         log_process();
@@ -15,6 +15,8 @@
 #include <zephyr/drivers/timer/system_timer.h>
 
 extern uint8_t power_manager_wake_button;
+/* True if this boot is a wake from System OFF, so retained RAM may hold valid caches */
+extern bool power_manager_woke_from_off;
 
 int print_reset_cause(uint32_t reset_cause);
 void power_manager_prepare_power_off();
@@ -0,0 +1,114 @@
+/**
+ * @file retained_state.c
+ * @brief RAM caches kept powered through System OFF
+ */
+
+#include "retained_state.h"
+#include "power_manager.h"
+
+#include <zephyr/devicetree.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/crc.h>
+#include <hal/nrf_power.h>
+#include <string.h>
+
+LOG_MODULE_REGISTER(retained_state, LOG_LEVEL_INF);
+
+#define RETAINED_STATE_MAGIC 0x48524331 /* "HRC1" */
+
+/* nRF52832 RAM: eight blocks of two 4 KB sections, each with its own retention switch */
+#define RETAINED_RAM_BASE         DT_REG_ADDR(DT_CHOSEN(zephyr_sram))
+#define RETAINED_RAM_SECTION_SIZE 0x1000
+#define RETAINED_RAM_SECTIONS_PER_BLOCK 2
+
+struct retained_region {
+	const char *name;
+	struct retained_seal *seal;
+	void *data;
+	size_t len;
+};
+
+static struct retained_region regions[RETAINED_STATE_MAX_REGIONS];
+static uint8_t region_count;
+
+static uint32_t retained_state_crc(const void *data, size_t len)
+{
+	return crc32_ieee((const uint8_t *)data, len);
+}
+
+/* Keeps the RAM sections covering [addr, addr + len) powered in System OFF */
+static void retained_state_retain_ram(const void *addr, size_t len)
+{
+	uintptr_t start = (uintptr_t)addr - RETAINED_RAM_BASE;
+	uintptr_t end = start + len - 1;
+
+	for (uintptr_t section = start / RETAINED_RAM_SECTION_SIZE;
+	     section <= end / RETAINED_RAM_SECTION_SIZE; section++) {
+		uint8_t block = section / RETAINED_RAM_SECTIONS_PER_BLOCK;
+		uint8_t sub = section % RETAINED_RAM_SECTIONS_PER_BLOCK;
+
+		NRF_POWER->RAM[block].POWERSET = POWER_RAM_POWER_S0RETENTION_Msk << sub;
+	}
+}
+
+/**
+ * @brief Restore a cache kept through System OFF and register it for the next one
+ */
+bool retained_state_restore(const char *name, struct retained_seal *seal, void *data,
+			    size_t len)
+{
+	bool valid = power_manager_woke_from_off && seal->magic == RETAINED_STATE_MAGIC &&
+		     seal->len == len && seal->crc == retained_state_crc(data, len);
+
+	/* Broken right away, the content changes from here on */
+	seal->magic = 0;
+
+	if (!valid) {
+		memset(data, 0, len);
+	}
+
+	bool registered = false;
+	for (uint8_t i = 0; i < region_count; i++) {
+		if (regions[i].seal == seal) {
+			registered = true;
+		}
+	}
+
+	if (!registered) {
+		if (region_count < ARRAY_SIZE(regions)) {
+			regions[region_count++] = (struct retained_region){
+				.name = name,
+				.seal = seal,
+				.data = data,
+				.len = len,
+			};
+		} else {
+			LOG_WRN("No room to retain %s", name);
+		}
+	}
+
+	LOG_INF("%s %s retained RAM (%zu bytes)", name, valid ? "restored from" : "not in", len);
+	return valid;
+}
+
+/**
+ * @brief Seal all registered caches and keep their RAM powered through System OFF
+ */
+void retained_state_keep_all(void)
+{
+	size_t total = 0;
+
+	for (uint8_t i = 0; i < region_count; i++) {
+		struct retained_region *region = &regions[i];
+
+		region->seal->len = region->len;
+		region->seal->crc = retained_state_crc(region->data, region->len);
+		region->seal->magic = RETAINED_STATE_MAGIC;
+
+		retained_state_retain_ram(region->seal, sizeof(*region->seal));
+		retained_state_retain_ram(region->data, region->len);
+		total += region->len;
+	}
+
+	LOG_INF("Retaining %u caches (%zu bytes) through System OFF", region_count, total);
+}
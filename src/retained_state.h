@@ -0,0 +1,54 @@
+/**
+ * @file retained_state.h
+ * @brief RAM caches kept powered through System OFF
+ *
+ * Modules keep their RAM caches (bond table, GATT cache records, preset lists, display
+ * snapshot) in __noinit variables. Right before System OFF every cache is sealed with a
+ * CRC and the RAM sections holding it are kept powered. After a wake from System OFF a
+ * cache with an intact seal is used as is, otherwise the module rebuilds it from NVS.
+ */
+
+#ifndef RETAINED_STATE_H_
+#define RETAINED_STATE_H_
+
+#include <zephyr/kernel.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Most caches that can be registered for retention */
+#define RETAINED_STATE_MAX_REGIONS 8
+
+/**
+ * @brief Seal of a retained cache, kept next to it in __noinit RAM
+ */
+struct retained_seal {
+	uint32_t magic;
+	uint32_t len;
+	uint32_t crc;
+};
+
+/**
+ * @brief Restore a cache kept through System OFF and register it for the next one
+ *
+ * The cache is only used after a wake from System OFF with an intact seal. Otherwise it is
+ * zeroed and the caller falls back to NVS. The seal is broken either way, so a reset before
+ * the next power off never trusts the RAM content.
+ *
+ * @param name Name of the cache for logging
+ * @param seal Seal of the cache, in __noinit RAM
+ * @param data Cache, in __noinit RAM
+ * @param len Size of @p data
+ * @return true if the cache content survived System OFF
+ */
+bool retained_state_restore(const char *name, struct retained_seal *seal, void *data,
+			    size_t len);
+
+/**
+ * @brief Seal all registered caches and keep their RAM powered through System OFF
+ *
+ * Called last before sys_poweroff(), changes made afterwards break the seals.
+ */
+void retained_state_keep_all(void);
+
+#endif /* RETAINED_STATE_H_ */
@@ -1,5 +1,6 @@
 #include "vcp_controller.h"
 #include "vcp_settings.h"
+#include "gatt_cache.h"
 #include "devices_manager.h"
 #include "app_controller.h"
 #include "ble_manager.h"
@@ -154,42 +155,8 @@ static void vcp_discover_cb(struct bt_vcp_vol_ctlr *vol_ctlr, int err,
             /* Store handles for the current device */
             vcp_settings_store_handles(&ctx->info.addr, &handles);
 
-            /* If this is a new device (initial pairing) and part of a CSIP set, also store handles
-             * for all other set members. Since all hearing aids in the set have identical firmware
-             * and GATT layout, we can reuse the same handles for all set members.
-             * Skip this on reconnection to avoid unnecessary work and potential stack issues. */
-            // if (ctx->info.is_new_device) {
-                struct bond_collection collection;
-                if (devices_manager_get_bonded_devices_collection(&collection) == 0) {
-                    struct bonded_device_entry current_entry;
-                    if (devices_manager_find_bonded_entry_by_addr(&ctx->info.addr, &current_entry) &&
-                        current_entry.is_set_member) {
-
-                    LOG_DBG("Current device is CSIP set member, caching VCP handles for all set members");
-
-                    for (uint8_t i = 0; i < collection.count; i++) {
-                        /* Skip the current device (already stored) */
-                        if (bt_addr_le_cmp(&collection.devices[i].addr, &ctx->info.addr) == 0) {
-                            continue;
-                        }
-
-                        /* Only store for devices in the same CSIP set */
-                        if (collection.devices[i].is_set_member &&
-                            memcmp(collection.devices[i].sirk, current_entry.sirk, CSIP_SIRK_SIZE) == 0) {
-
-                            int err = vcp_settings_store_handles(&collection.devices[i].addr, &handles);
-                            if (err == 0) {
-                                char addr_str[BT_ADDR_LE_STR_LEN];
-                                bt_addr_le_to_str(&collection.devices[i].addr, addr_str, sizeof(addr_str));
-                                LOG_INF("VCP handles also cached for set member: %s", addr_str);
-                            } else {
-                                LOG_WRN("Failed to cache VCP handles for set member (err %d)", err);
-                            }
-                        }
-                    }
-                }
-                }
-            // }
+            /* Reuse the handles for the other set member if it runs the same firmware */
+            gatt_cache_share_with_set(&ctx->info.addr, GATT_CACHE_VCP, &handles, sizeof(handles));
         } else {
             LOG_WRN("Failed to get VCP handles for caching (err %d)", get_err);
         }
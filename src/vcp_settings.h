@@ -1,6 +1,6 @@
 /**
  * @file vcp_settings.h
- * @brief VCP handle caching in NVS settings
+ * @brief VCP handle caching in the GATT cache record
  */
 
 #ifndef VCP_SETTINGS_H_